@@ -17,6 +17,8 @@
 #include <pthread.h>
 
 #include "jni_helper.h"
+#include "ts_allocator.h"
+#include "ts_utils.h"
 
 // declare external JNI global variables
 extern jclass javaTSNodeClass;
@@ -25,6 +27,9 @@ extern jclass javaTSParserClass;
 extern jclass javaTSRangeClass;
 extern jclass javaTSInputEditClass;
 extern jclass javaTSLogTypeClass;
+extern jclass javaTSInputReaderClass;
+extern jclass javaTSLoggerClass;
+extern jclass javaTSBufferReaderClass;
 // ...
 extern jclass javaTSCaptureClass;
 extern jclass javaTSQuantifierClass;
@@ -34,7 +39,9 @@ extern jclass javaTSQueryPredicateStepClass;
 extern jclass javaTSQueryPredicateStepTypeClass;
 
 // global parser parse callback function
-extern jmethodID read;
+extern jmethodID reader;
+// global parser buffered parse callback function
+extern jmethodID bufferReader;
 // global parser log callback function
 extern jmethodID logger;
 
@@ -51,6 +58,14 @@ static pthread_key_t key;
         env->DeleteLocalRef(local);                  \
     } while(0)
 
+#define loadEnum(VARIABLE, CLASS, NAME, SIGNATURE) \
+    do {                                                            \
+        jfieldID field = env->GetStaticFieldID(CLASS, NAME, SIGNATURE); \
+        jobject local = env->GetStaticObjectField(CLASS, field);   \
+        VARIABLE = env->NewGlobalRef(local);                       \
+        env->DeleteLocalRef(local);                                \
+    } while(0)
+
 
 extern "C" JavaVM* getJavaVM() {
     return jvm;
@@ -83,6 +98,8 @@ extern "C" JNIEnv* getEnv() {
 
 extern "C" jint JNI_OnLoad(JavaVM *vm, void *reserved) {
     jvm = vm; // init the global jvm
+    // before tree-sitter allocates anything
+    installAllocator();
     JNIEnv *env = getEnv();
     if(env == nullptr) {
         LOGE("Failed to init the jvm environment\n");
@@ -99,6 +116,9 @@ extern "C" jint JNI_OnLoad(JavaVM *vm, void *reserved) {
     loadClass(javaTSRangeClass, "io/github/module/treesitter/TSRange");
     loadClass(javaTSInputEditClass, "io/github/module/treesitter/TSInputEdit");
     loadClass(javaTSLogTypeClass, "io/github/module/treesitter/TSLogType");
+    loadClass(javaTSInputReaderClass, "io/github/module/treesitter/TSInputReader");
+    loadClass(javaTSLoggerClass, "io/github/module/treesitter/TSLogger");
+    loadClass(javaTSBufferReaderClass, "io/github/module/treesitter/TSBufferReader");
     // ...
     loadClass(javaTSCaptureClass, "io/github/module/treesitter/TSCapture");
     loadClass(javaTSQuantifierClass, "io/github/module/treesitter/TSQuantifier");
@@ -112,16 +132,116 @@ extern "C" jint JNI_OnLoad(JavaVM *vm, void *reserved) {
         javaTSQueryPredicateStepTypeClass, 
         "io/github/module/treesitter/TSQueryPredicateStepType"
     );
+    loadClass(javaTSQueryErrorClass, "io/github/module/treesitter/TSQueryError");
+    loadClass(javaIOExceptionClass, "java/io/IOException");
+    loadClass(javaIllegalStateExceptionClass, "java/lang/IllegalStateException");
+    loadClass(javaIllegalArgumentExceptionClass, "java/lang/IllegalArgumentException");
+    loadClass(javaTSQueryCapturesClass, "io/github/module/treesitter/TSQueryCaptures");
+    
+    // cache the method and field ids, the hot paths only load a pointer
+    javaTSNodeConstructor = env->GetMethodID(javaTSNodeClass, "<init>", "(IIIIJJ)V");
+    javaTSNodeContext[0] = env->GetFieldID(javaTSNodeClass, "context0", "I");
+    javaTSNodeContext[1] = env->GetFieldID(javaTSNodeClass, "context1", "I");
+    javaTSNodeContext[2] = env->GetFieldID(javaTSNodeClass, "context2", "I");
+    javaTSNodeContext[3] = env->GetFieldID(javaTSNodeClass, "context3", "I");
+    javaTSNodeId = env->GetFieldID(javaTSNodeClass, "id", "J");
+    javaTSNodeTree = env->GetFieldID(javaTSNodeClass, "tree", "J");
+    
+    javaTSPointConstructor = env->GetMethodID(javaTSPointClass, "<init>", "(II)V");
+    javaTSPointRow = env->GetFieldID(javaTSPointClass, "row", "I");
+    javaTSPointColumn = env->GetFieldID(javaTSPointClass, "column", "I");
+    
+    javaTSRangeConstructor = env->GetMethodID(
+        javaTSRangeClass, 
+        "<init>", 
+        "(Lio/github/module/treesitter/TSPoint;Lio/github/module/treesitter/TSPoint;II)V"
+    );
+    
+    javaTSInputEditStartByte = env->GetFieldID(javaTSInputEditClass, "startByte", "I");
+    javaTSInputEditOldEndByte = env->GetFieldID(javaTSInputEditClass, "oldEndByte", "I");
+    javaTSInputEditNewEndByte = env->GetFieldID(javaTSInputEditClass, "newEndByte", "I");
+    javaTSInputEditStartPoint = env->GetFieldID(
+        javaTSInputEditClass, "startPoint", "Lio/github/module/treesitter/TSPoint;"
+    );
+    javaTSInputEditOldEndPoint = env->GetFieldID(
+        javaTSInputEditClass, "oldEndPoint", "Lio/github/module/treesitter/TSPoint;"
+    );
+    javaTSInputEditNewEndPoint = env->GetFieldID(
+        javaTSInputEditClass, "newEndPoint", "Lio/github/module/treesitter/TSPoint;"
+    );
+    
+    javaTSCaptureConstructor = env->GetMethodID(
+        javaTSCaptureClass, 
+        "<init>", 
+        "(Lio/github/module/treesitter/TSQueryMatch;I)V"
+    );
+    javaTSQueryCaptureConstructor = env->GetMethodID(
+        javaTSQueryCaptureClass, 
+        "<init>", 
+        "(Lio/github/module/treesitter/TSNode;I)V"
+    );
+    javaTSQueryMatchConstructor = env->GetMethodID(
+        javaTSQueryMatchClass, 
+        "<init>", 
+        "(III[Lio/github/module/treesitter/TSQueryCapture;)V"
+    );
+    javaTSQueryPredicateStepConstructor = env->GetMethodID(
+        javaTSQueryPredicateStepClass, 
+        "<init>", 
+        "(Lio/github/module/treesitter/TSQueryPredicateStepType;I)V"
+    );
+    javaTSQueryCapturesConstructor = env->GetMethodID(
+        javaTSQueryCapturesClass, 
+        "<init>", 
+        "(I[I[J)V"
+    );
+    
+    jclass javaEnumClass = env->FindClass("java/lang/Enum");
+    javaEnumOrdinal = env->GetFieldID(javaEnumClass, "ordinal", "I");
+    env->DeleteLocalRef(javaEnumClass);
+    
+    // the enum constants, in the order of the native enum values
+    const char *logTypes[] = {"PARSE", "LEX"};
+    for(int i=0; i < 2; ++i) {
+        loadEnum(javaTSLogTypes[i], javaTSLogTypeClass, logTypes[i], 
+                 "Lio/github/module/treesitter/TSLogType;");
+    }
+    
+    const char *quantifiers[] = {"ZERO", "ZERO_OR_ONE", "ZERO_OR_MORE", "ONE", "ONE_OR_MORE"};
+    for(int i=0; i < 5; ++i) {
+        loadEnum(javaTSQuantifiers[i], javaTSQuantifierClass, quantifiers[i], 
+                 "Lio/github/module/treesitter/TSQuantifier;");
+    }
     
-    read = env->GetStaticMethodID(
-        javaTSParserClass, 
+    const char *queryErrors[] = {
+        "NONE", "SYNTAX", "NODE_TYPE", "FIELD", "CAPTURE", "STRUCTURE", "LANGUAGE"
+    };
+    for(int i=0; i < 7; ++i) {
+        loadEnum(javaTSQueryErrors[i], javaTSQueryErrorClass, queryErrors[i], 
+                 "Lio/github/module/treesitter/TSQueryError;");
+    }
+    
+    const char *predicateStepTypes[] = {"DOWN", "CAPTURE", "STRING"};
+    for(int i=0; i < 3; ++i) {
+        loadEnum(javaTSQueryPredicateStepTypes[i], javaTSQueryPredicateStepTypeClass, 
+                 predicateStepTypes[i], "Lio/github/module/treesitter/TSQueryPredicateStepType;");
+    }
+    
+    reader = env->GetMethodID(
+        javaTSInputReaderClass, 
         "read", 
-        "(ILio/github/module/treesitter/TSPoint;)[B"
+        "(III)[B"
     );
     
-    logger = env->GetStaticMethodID(
-        javaTSParserClass, 
-        "logger", 
+    bufferReader = env->GetMethodID(
+        javaTSBufferReaderClass, 
+        "read", 
+        "(ILjava/nio/ByteBuffer;)I"
+    );
+    
+    logger = env->GetMethodID(
+        javaTSLoggerClass, 
+        "log", 
         "(Lio/github/module/treesitter/TSLogType;Ljava/lang/String;)V"
     );
     
@@ -137,6 +257,9 @@ extern "C" void JNI_OnUnload(JavaVM *vm, void *reserved) {
     env->DeleteGlobalRef(javaTSRangeClass);
     env->DeleteGlobalRef(javaTSInputEditClass);
     env->DeleteGlobalRef(javaTSLogTypeClass);
+    env->DeleteGlobalRef(javaTSInputReaderClass);
+    env->DeleteGlobalRef(javaTSLoggerClass);
+    env->DeleteGlobalRef(javaTSBufferReaderClass);
     // ...
     env->DeleteGlobalRef(javaTSCaptureClass);
     env->DeleteGlobalRef(javaTSQuantifierClass);
@@ -144,6 +267,16 @@ extern "C" void JNI_OnUnload(JavaVM *vm, void *reserved) {
     env->DeleteGlobalRef(javaTSQueryMatchClass);
     env->DeleteGlobalRef(javaTSQueryPredicateStepClass);
     env->DeleteGlobalRef(javaTSQueryPredicateStepTypeClass);
+    env->DeleteGlobalRef(javaTSQueryErrorClass);
+    env->DeleteGlobalRef(javaIOExceptionClass);
+    env->DeleteGlobalRef(javaIllegalStateExceptionClass);
+    env->DeleteGlobalRef(javaIllegalArgumentExceptionClass);
+    env->DeleteGlobalRef(javaTSQueryCapturesClass);
+    
+    for(jobject object : javaTSLogTypes) env->DeleteGlobalRef(object);
+    for(jobject object : javaTSQuantifiers) env->DeleteGlobalRef(object);
+    for(jobject object : javaTSQueryErrors) env->DeleteGlobalRef(object);
+    for(jobject object : javaTSQueryPredicateStepTypes) env->DeleteGlobalRef(object);
     
     LOGI("JNI_OnUnload\n");
 }
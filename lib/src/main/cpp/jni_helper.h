@@ -18,6 +18,7 @@
 #define __JNI_HELPER_H__
 
 #include <jni.h>
+#include <stdio.h>
 
 #ifdef __ANDROID__
 #include <android/log.h>
@@ -37,7 +38,7 @@ extern "C" {
 #define  LOGI(...)  __android_log_print(ANDROID_LOG_INFO, TAG, __VA_ARGS__)
 // log.e
 #define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
-#elif
+#else
 // C-Style log print
 #define  LOGI(...) fprintf(stdout, __VA_ARGS__)
 #define  LOGE(...) fprintf(stderr, __VA_ARGS__)
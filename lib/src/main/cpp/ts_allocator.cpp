@@ -0,0 +1,510 @@
+/*
+ * Copyright © 2023 Github Lzhiyong
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <tree_sitter/api.h>
+
+#include "jni_helper.h"
+#include "ts_allocator.h"
+#include "ts_subtree.h"
+#include "ts_utils.h"
+
+// every block starts with a header of 16 bytes, which keeps the alignment
+// of malloc and tells free where the block came from and how it is counted
+#define ORIGIN_HEAP 0
+#define ORIGIN_POOL 1
+#define ORIGIN_ARENA 2
+
+struct AllocationHeader {
+    uint64_t size;
+    uint16_t origin;
+    uint16_t kind;
+    uint32_t sizeClass;
+};
+
+static_assert(sizeof(AllocationHeader) == 16, "the header must keep the alignment of 16");
+
+// the pooled size classes are powers of two from 16 to 4096 bytes, 
+// every thread keeps a bounded free list of each class
+#define SIZE_CLASS_COUNT 9
+#define SIZE_CLASS_MIN_SHIFT 4
+#define SIZE_CLASS_CAPACITY 512
+
+// the arena chunks are allocated from the heap, a large block gets its own chunk
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+struct Arena {
+    Arena *previous;
+    // the parsers and trees allocated from the arena that are not deleted yet
+    std::atomic<int64_t> objects;
+    size_t chunkSize;
+    std::vector<char*> chunks;
+    char *cursor;
+    char *limit;
+    // the bytes handed out, including the headers
+    size_t allocated;
+    // the bytes of the chunks
+    size_t reserved;
+    // the last block, it is grown in place by realloc
+    AllocationHeader *last;
+};
+
+struct SizeClassCache {
+    std::vector<AllocationHeader*> blocks[SIZE_CLASS_COUNT];
+    
+    ~SizeClassCache() {
+        for(auto &list : blocks) {
+            for(AllocationHeader *header : list) free(header);
+        }
+    }
+};
+
+// the live bytes, live blocks and allocated blocks of each kind, 
+// the arena blocks are counted as the arena bytes only
+struct KindCounters {
+    std::atomic<int64_t> liveBytes;
+    std::atomic<int64_t> liveCount;
+    std::atomic<int64_t> totalCount;
+};
+
+static std::atomic<int> allocatorMode(ALLOCATOR_MODE_DEFAULT);
+// the innermost arena begun on the thread, and the arena allocated from, 
+// which is only set while the thread works on an object of the arena
+static thread_local Arena *currentArena = nullptr;
+static thread_local Arena *allocationArena = nullptr;
+static thread_local SizeClassCache sizeClassCache;
+
+static KindCounters kindCounters[MEMORY_KIND_COUNT];
+static std::atomic<int64_t> arenaBytes(0);
+static thread_local int currentKind = MEMORY_KIND_OTHER;
+
+static inline void countAllocation(const AllocationHeader *header) {
+    KindCounters &counters = kindCounters[header->kind];
+    counters.liveBytes.fetch_add(header->size, std::memory_order_relaxed);
+    counters.liveCount.fetch_add(1, std::memory_order_relaxed);
+    counters.totalCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+static inline void countFree(const AllocationHeader *header) {
+    KindCounters &counters = kindCounters[header->kind];
+    counters.liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+    counters.liveCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// the size of a reallocated block in place
+static inline void countResize(AllocationHeader *header, size_t size) {
+    int64_t delta = static_cast<int64_t>(size) - static_cast<int64_t>(header->size);
+    kindCounters[header->kind].liveBytes.fetch_add(delta, std::memory_order_relaxed);
+    header->size = size;
+}
+
+static inline void *blockData(AllocationHeader *header) {
+    return reinterpret_cast<char*>(header) + sizeof(AllocationHeader);
+}
+
+static inline AllocationHeader *blockHeader(void *data) {
+    return reinterpret_cast<AllocationHeader*>(static_cast<char*>(data) - sizeof(AllocationHeader));
+}
+
+// the size class fitting the size, or -1 if the size is too large to pool
+static inline int sizeClassOf(size_t size) {
+    for(int sizeClass=0; sizeClass < SIZE_CLASS_COUNT; ++sizeClass) {
+        if(size <= (static_cast<size_t>(1) << (sizeClass + SIZE_CLASS_MIN_SHIFT))) 
+            return sizeClass;
+    }
+    return -1;
+}
+
+static void *arenaAllocate(Arena *arena, size_t size) {
+    size_t blockSize = (sizeof(AllocationHeader) + size + 15) & ~static_cast<size_t>(15);
+    if(arena->cursor == nullptr || blockSize > static_cast<size_t>(arena->limit - arena->cursor)) {
+        size_t chunkSize = std::max(arena->chunkSize, blockSize);
+        char *chunk = static_cast<char*>(malloc(chunkSize));
+        if(chunk == nullptr) return nullptr;
+        arena->chunks.push_back(chunk);
+        arena->reserved += chunkSize;
+        arenaBytes.fetch_add(chunkSize, std::memory_order_relaxed);
+        // a large block does not replace the current chunk
+        if(chunkSize > arena->chunkSize && arena->cursor != nullptr) {
+            AllocationHeader *header = reinterpret_cast<AllocationHeader*>(chunk);
+            header->size = size;
+            header->origin = ORIGIN_ARENA;
+            header->kind = currentKind;
+            header->sizeClass = 0;
+            arena->allocated += blockSize;
+            return blockData(header);
+        }
+        arena->cursor = chunk;
+        arena->limit = chunk + chunkSize;
+    }
+    
+    AllocationHeader *header = reinterpret_cast<AllocationHeader*>(arena->cursor);
+    header->size = size;
+    header->origin = ORIGIN_ARENA;
+    header->kind = currentKind;
+    header->sizeClass = 0;
+    arena->cursor += blockSize;
+    arena->allocated += blockSize;
+    arena->last = header;
+    return blockData(header);
+}
+
+static void *heapAllocate(size_t size, int kind) {
+    if(allocatorMode.load(std::memory_order_relaxed) == ALLOCATOR_MODE_POOLED) {
+        int sizeClass = sizeClassOf(size);
+        if(sizeClass >= 0) {
+            AllocationHeader *header;
+            std::vector<AllocationHeader*> &list = sizeClassCache.blocks[sizeClass];
+            if(!list.empty()) {
+                header = list.back();
+                list.pop_back();
+            } else {
+                size_t classSize = static_cast<size_t>(1) << (sizeClass + SIZE_CLASS_MIN_SHIFT);
+                header = static_cast<AllocationHeader*>(malloc(sizeof(AllocationHeader) + classSize));
+                if(header == nullptr) return nullptr;
+            }
+            header->size = size;
+            header->origin = ORIGIN_POOL;
+            header->kind = kind;
+            header->sizeClass = sizeClass;
+            countAllocation(header);
+            return blockData(header);
+        }
+    }
+    
+    AllocationHeader *header = static_cast<AllocationHeader*>(malloc(sizeof(AllocationHeader) + size));
+    if(header == nullptr) return nullptr;
+    header->size = size;
+    header->origin = ORIGIN_HEAP;
+    header->kind = kind;
+    header->sizeClass = 0;
+    countAllocation(header);
+    return blockData(header);
+}
+
+static void *allocatorMalloc(size_t size) {
+    if(allocationArena != nullptr) 
+        return arenaAllocate(allocationArena, size);
+    return heapAllocate(size, currentKind);
+}
+
+static void *allocatorCalloc(size_t count, size_t size) {
+    void *data = allocatorMalloc(count * size);
+    if(data != nullptr) memset(data, 0, count * size);
+    return data;
+}
+
+// the block stays in the heap or the pool it came from, an arena 
+// block moves to the arena of the calling thread or to the heap
+static void *allocatorRealloc(void *data, size_t size) {
+    if(data == nullptr) return allocatorMalloc(size);
+    
+    AllocationHeader *header = blockHeader(data);
+    switch(header->origin) {
+        case ORIGIN_HEAP: {
+            size_t oldSize = header->size;
+            header = static_cast<AllocationHeader*>(realloc(header, sizeof(AllocationHeader) + size));
+            if(header == nullptr) return nullptr;
+            header->size = oldSize;
+            countResize(header, size);
+            return blockData(header);
+        }
+        case ORIGIN_POOL: {
+            if(size <= (static_cast<size_t>(1) << (header->sizeClass + SIZE_CLASS_MIN_SHIFT))) {
+                countResize(header, size);
+                return data;
+            }
+            break;
+        }
+        case ORIGIN_ARENA: {
+            Arena *arena = allocationArena;
+            // the last block of the arena grows in place
+            if(arena != nullptr && arena->last == header) {
+                size_t oldSize = (sizeof(AllocationHeader) + header->size + 15) & ~static_cast<size_t>(15);
+                size_t newSize = (sizeof(AllocationHeader) + size + 15) & ~static_cast<size_t>(15);
+                char *start = reinterpret_cast<char*>(header);
+                if(newSize <= static_cast<size_t>(arena->limit - start)) {
+                    arena->cursor = start + newSize;
+                    arena->allocated += newSize - oldSize;
+                    header->size = size;
+                    return data;
+                }
+            }
+            break;
+        }
+    }
+    
+    void *newData;
+    if(header->origin == ORIGIN_ARENA) {
+        KindScope scope(header->kind);
+        newData = allocatorMalloc(size);
+    } else {
+        newData = heapAllocate(size, header->kind);
+    }
+    if(newData == nullptr) return nullptr;
+    memcpy(newData, data, std::min<size_t>(header->size, size));
+    allocatorFree(data);
+    return newData;
+}
+
+void allocatorFree(void *data) {
+    if(data == nullptr) return;
+    
+    AllocationHeader *header = blockHeader(data);
+    switch(header->origin) {
+        case ORIGIN_HEAP:
+            countFree(header);
+            free(header);
+            break;
+        case ORIGIN_POOL: {
+            countFree(header);
+            std::vector<AllocationHeader*> &list = sizeClassCache.blocks[header->sizeClass];
+            if(allocatorMode.load(std::memory_order_relaxed) == ALLOCATOR_MODE_POOLED 
+               && list.size() < SIZE_CLASS_CAPACITY) {
+                list.push_back(header);
+            } else {
+                free(header);
+            }
+            break;
+        }
+        default:
+            // the arena memory is released with the arena
+            break;
+    }
+}
+
+void installAllocator() {
+    ts_set_allocator(allocatorMalloc, allocatorCalloc, allocatorRealloc, allocatorFree);
+}
+
+bool isArenaBlock(const void *data) {
+    if(data == nullptr) return false;
+    const AllocationHeader *header = reinterpret_cast<const AllocationHeader*>(
+        static_cast<const char*>(data) - sizeof(AllocationHeader)
+    );
+    return header->origin == ORIGIN_ARENA;
+}
+
+void *currentThreadArena() {
+    return currentArena;
+}
+
+void retainArena(void *arena) {
+    static_cast<Arena*>(arena)->objects.fetch_add(1, std::memory_order_relaxed);
+}
+
+void releaseArena(void *arena) {
+    static_cast<Arena*>(arena)->objects.fetch_sub(1, std::memory_order_release);
+}
+
+ArenaScope::ArenaScope(void *arena) {
+    previous = allocationArena;
+    allocationArena = static_cast<Arena*>(arena);
+}
+
+ArenaScope::~ArenaScope() {
+    allocationArena = static_cast<Arena*>(previous);
+}
+
+KindScope::KindScope(int kind) {
+    previous = currentKind;
+    currentKind = kind;
+}
+
+KindScope::~KindScope() {
+    currentKind = previous;
+}
+
+// count the block as the tree from now on
+static void retagTreeBlock(void *payload, void *data) {
+    AllocationHeader *header = blockHeader(data);
+    if(header->origin == ORIGIN_ARENA || header->kind == MEMORY_KIND_TREE) return;
+    
+    KindCounters &from = kindCounters[header->kind];
+    KindCounters &to = kindCounters[MEMORY_KIND_TREE];
+    from.liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+    from.liveCount.fetch_sub(1, std::memory_order_relaxed);
+    from.totalCount.fetch_sub(1, std::memory_order_relaxed);
+    to.liveBytes.fetch_add(header->size, std::memory_order_relaxed);
+    to.liveCount.fetch_add(1, std::memory_order_relaxed);
+    to.totalCount.fetch_add(1, std::memory_order_relaxed);
+    header->kind = MEMORY_KIND_TREE;
+}
+
+// a subtree counted as the tree was reused from the old tree or created by an
+// edit, its descendants are counted as the tree too
+static bool retagTreeSubtree(void *payload, void *data, uint32_t references) {
+    if(blockHeader(data)->kind == MEMORY_KIND_TREE) return false;
+    retagTreeBlock(payload, data);
+    return true;
+}
+
+void retagTree(const TSTree *tree) {
+    TreeBlockVisitor visitor {retagTreeSubtree, retagTreeBlock, nullptr};
+    visitTreeBlocks(tree, &visitor);
+}
+
+// the arena blocks are released with the arena, not with the tree
+static void countTreeBlock(void *payload, void *data) {
+    const AllocationHeader *header = blockHeader(data);
+    if(header->origin != ORIGIN_ARENA) 
+        *static_cast<int64_t*>(payload) += header->size;
+}
+
+// a subtree with more than one reference is shared with another 
+// tree, a copy or another parent, so are its descendants
+static bool countTreeSubtree(void *payload, void *data, uint32_t references) {
+    if(references > 1) return false;
+    countTreeBlock(payload, data);
+    return true;
+}
+
+int64_t treeExclusiveBytes(const TSTree *tree) {
+    int64_t bytes = 0;
+    TreeBlockVisitor visitor {countTreeSubtree, countTreeBlock, &bytes};
+    visitTreeBlocks(tree, &visitor);
+    return bytes;
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Set how the blocks outside of an arena are allocated: `malloc` for each
+ * block, or size classes recycled through free lists of the calling thread.
+ * The mode can be changed at any time, every block remembers where it came
+ * from.
+ */
+JNIEXPORT void JNICALL
+Java_io_github_module_treesitter_TreeSitter_setAllocatorMode(JNIEnv* env, jobject thiz, jobject mode) {
+    allocatorMode.store(env->GetIntField(mode, javaEnumOrdinal));
+}
+
+JNIEXPORT jint JNICALL
+Java_io_github_module_treesitter_TreeSitter_getAllocatorMode(JNIEnv* env, jobject thiz) {
+    return allocatorMode.load();
+}
+
+/**
+ * Begin an arena on the calling thread. Only the parsers created by 
+ * `newArenaParser` allocate from the arena, together with the trees that they
+ * parse. Freeing an arena block does nothing, all of the blocks are released
+ * at once when the arena ends. Arenas can be nested.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_beginArena(JNIEnv* env, jobject thiz, jint chunkSize) {
+    Arena *arena = new Arena();
+    arena->previous = currentArena;
+    arena->objects.store(0, std::memory_order_relaxed);
+    arena->chunkSize = chunkSize > 0 ? chunkSize : ARENA_CHUNK_SIZE;
+    arena->cursor = nullptr;
+    arena->limit = nullptr;
+    arena->allocated = 0;
+    arena->reserved = 0;
+    arena->last = nullptr;
+    currentArena = arena;
+    return reinterpret_cast<jlong>(arena);
+}
+
+/**
+ * End the arena and release all of its memory. Returns false and keeps the
+ * arena if it is not the innermost arena of the calling thread, or if its
+ * parsers and trees are not all deleted.
+ */
+JNIEXPORT jboolean JNICALL
+Java_io_github_module_treesitter_TreeSitter_endArena(JNIEnv* env, jobject thiz, jlong arena) {
+    Arena *nativeArena = reinterpret_cast<Arena*>(arena);
+    if(nativeArena != currentArena) {
+        LOGE("Error: %s\n", "the arena is not the innermost arena of this thread");
+        return false;
+    }
+    if(nativeArena->objects.load(std::memory_order_acquire) > 0) {
+        LOGE("Error: %s\n", "the arena still owns parsers or trees");
+        return false;
+    }
+    
+    currentArena = nativeArena->previous;
+    arenaBytes.fetch_sub(nativeArena->reserved, std::memory_order_relaxed);
+    for(char *chunk : nativeArena->chunks) free(chunk);
+    delete nativeArena;
+    return true;
+}
+
+/**
+ * Count a tree copy as an object of the arena, the copy 
+ * shares the subtrees of its tree.
+ */
+JNIEXPORT void JNICALL
+Java_io_github_module_treesitter_TreeSitter_retainArena(JNIEnv* env, jobject thiz, jlong arena) {
+    retainArena(reinterpret_cast<void*>(arena));
+}
+
+/**
+ * Release an object of the arena after it is deleted.
+ */
+JNIEXPORT void JNICALL
+Java_io_github_module_treesitter_TreeSitter_releaseArena(JNIEnv* env, jobject thiz, jlong arena) {
+    releaseArena(reinterpret_cast<void*>(arena));
+}
+
+/**
+ * Get the number of bytes allocated from the arena.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_arenaSize(JNIEnv* env, jobject thiz, jlong arena) {
+    return reinterpret_cast<Arena*>(arena)->allocated;
+}
+
+/**
+ * Get a snapshot of the counted memory: the live bytes, live blocks and
+ * allocated blocks of each kind, 3 longs per kind, followed by the bytes
+ * reserved by the arenas of all threads. The counters are read without a
+ * lock, so the kinds may be a few blocks apart.
+ */
+JNIEXPORT jlongArray JNICALL
+Java_io_github_module_treesitter_TreeSitter_memoryStats(JNIEnv* env, jobject thiz) {
+    jlong values[MEMORY_KIND_COUNT * 3 + 1];
+    for(int kind=0; kind < MEMORY_KIND_COUNT; ++kind) {
+        values[kind * 3] = kindCounters[kind].liveBytes.load(std::memory_order_relaxed);
+        values[kind * 3 + 1] = kindCounters[kind].liveCount.load(std::memory_order_relaxed);
+        values[kind * 3 + 2] = kindCounters[kind].totalCount.load(std::memory_order_relaxed);
+    }
+    values[MEMORY_KIND_COUNT * 3] = arenaBytes.load(std::memory_order_relaxed);
+    
+    jlongArray valueArray = env->NewLongArray(MEMORY_KIND_COUNT * 3 + 1);
+    env->SetLongArrayRegion(valueArray, 0, MEMORY_KIND_COUNT * 3 + 1, values);
+    return valueArray;
+}
+
+/**
+ * Get the live bytes owned by the tree alone, which are freed when the tree is
+ * deleted. The subtrees shared with another tree or a copy are not counted in
+ * either tree until the other one is deleted. The tree is walked on each call.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_treeExclusiveBytes(JNIEnv* env, jobject thiz, jlong tree) {
+    return treeExclusiveBytes(reinterpret_cast<const TSTree*>(tree));
+}
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
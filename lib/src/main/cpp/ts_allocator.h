@@ -0,0 +1,79 @@
+/*
+ * Copyright © 2023 Github Lzhiyong
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TS_ALLOCATOR_H__
+#define __TS_ALLOCATOR_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tree_sitter/api.h>
+
+// the allocation modes, see TSAllocatorMode
+#define ALLOCATOR_MODE_DEFAULT 0
+#define ALLOCATOR_MODE_POOLED 1
+
+// the kinds of the counted memory, see TSMemoryKind
+#define MEMORY_KIND_OTHER 0
+#define MEMORY_KIND_PARSER 1
+#define MEMORY_KIND_TREE 2
+#define MEMORY_KIND_TREE_CURSOR 3
+#define MEMORY_KIND_QUERY 4
+#define MEMORY_KIND_QUERY_CURSOR 5
+#define MEMORY_KIND_COUNT 6
+
+// install the allocator into tree-sitter, it must be called
+// before tree-sitter allocates anything, see JNI_OnLoad
+void installAllocator();
+
+// free the memory returned by the tree-sitter functions, 
+// e.g. ts_node_string and ts_tree_get_changed_ranges
+void allocatorFree(void*);
+
+// whether the block was allocated from an arena, the block must be alive
+bool isArenaBlock(const void*);
+
+// the innermost arena begun on the calling thread or null
+void *currentThreadArena();
+
+// the parsers and trees of an arena, the arena can not 
+// end until every object it owns is released
+void retainArena(void*);
+void releaseArena(void*);
+
+// allocate from the arena while in scope, a null arena allocates from the heap
+struct ArenaScope {
+    explicit ArenaScope(void *arena);
+    ~ArenaScope();
+    void *previous;
+};
+
+// count the blocks allocated by the calling thread as the given kind while in 
+// scope, a reallocated block keeps the kind it was allocated with
+struct KindScope {
+    explicit KindScope(int kind);
+    ~KindScope();
+    int previous;
+};
+
+// count the blocks of a parsed tree as the tree instead of the parser, 
+// the subtrees reused from the old tree are counted as the tree already
+void retagTree(const TSTree*);
+
+// the live bytes freed when the tree is deleted, the subtrees 
+// shared with another tree or a copy are not counted
+int64_t treeExclusiveBytes(const TSTree*);
+
+#endif // __TS_ALLOCATOR_H__
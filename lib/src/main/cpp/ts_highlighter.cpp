@@ -0,0 +1,282 @@
+/*
+ * Copyright © 2023 Github Lzhiyong
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <vector>
+#include <tree_sitter/api.h>
+
+#include "jni_helper.h"
+#include "ts_allocator.h"
+#include "ts_utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// declare external functions
+extern bool checkPredicates(JNIEnv*, const jlong, jbyteArray, const TSInputEncoding, const TSQueryMatch*);
+
+// a highlighted capture, stored in every row that it covers
+struct HighlightSpan {
+    uint32_t startByte;
+    uint32_t endByte;
+    uint32_t startRow;
+    uint32_t capture;
+};
+
+// the cached spans of each row, the rows that are not valid 
+// are queried again when they become visible
+struct TSHighlighter {
+    const TSQuery *query;
+    TSQueryCursor *cursor;
+    // a copy of the highlighted tree, edited along with the document
+    TSTree *tree;
+    std::vector<std::vector<HighlightSpan>> rows;
+    std::vector<bool> valid;
+};
+
+static void invalidateRows(TSHighlighter *highlighter, const uint32_t startRow, const uint32_t endRow) {
+    uint32_t end = std::min<uint32_t>(endRow, highlighter->valid.size() - 1);
+    for(uint32_t row = startRow; row <= end && row < highlighter->valid.size(); ++row) {
+        highlighter->valid[row] = false;
+        highlighter->rows[row].clear();
+    }
+}
+
+// query the rows [startRow, endRow) again and cache the spans of every row
+static void queryRows(JNIEnv *env, TSHighlighter *highlighter, const uint32_t startRow, const uint32_t endRow,
+                      const jlong predicates, jbyteArray bytes, const TSInputEncoding encoding) {
+    for(uint32_t row = startRow; row < endRow; ++row) 
+        highlighter->rows[row].clear();
+    
+    ts_query_cursor_set_point_range(highlighter->cursor, {startRow, 0}, {endRow, 0});
+    ts_query_cursor_exec(highlighter->cursor, highlighter->query, ts_tree_root_node(highlighter->tree));
+    
+    TSQueryMatch match;
+    uint32_t captureIndex;
+    while(ts_query_cursor_next_capture(highlighter->cursor, &match, &captureIndex)) {
+        if(bytes != nullptr && predicates != 0 && !checkPredicates(env, predicates, bytes, encoding, &match)) {
+            ts_query_cursor_remove_match(highlighter->cursor, match.id);
+            continue;
+        }
+        
+        TSNode node = match.captures[captureIndex].node;
+        HighlightSpan span {
+            ts_node_start_byte(node),
+            ts_node_end_byte(node),
+            ts_node_start_point(node).row,
+            match.captures[captureIndex].index
+        };
+        if(span.startByte == span.endByte) continue;
+        
+        uint32_t lastRow = std::min(ts_node_end_point(node).row, endRow - 1);
+        for(uint32_t row = std::max(span.startRow, startRow); row <= lastRow; ++row)
+            highlighter->rows[row].push_back(span);
+    }
+    
+    for(uint32_t row = startRow; row < endRow; ++row) 
+        highlighter->valid[row] = true;
+}
+
+/**
+ * Create a new highlighter running the given query, the query must outlive
+ * the highlighter.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_newHighlighter(JNIEnv* env, jobject thiz, jlong query) {
+    TSHighlighter *highlighter = new TSHighlighter();
+    highlighter->query = reinterpret_cast<TSQuery*>(query);
+    KindScope scope(MEMORY_KIND_QUERY_CURSOR);
+    highlighter->cursor = ts_query_cursor_new();
+    highlighter->tree = nullptr;
+    return reinterpret_cast<jlong>(highlighter);
+}
+
+/**
+ * Delete the highlighter, its query cursor and its copy of the tree.
+ */
+JNIEXPORT void JNICALL
+Java_io_github_module_treesitter_TreeSitter_deleteHighlighter(JNIEnv* env, jobject thiz, jlong highlighter) {
+    TSHighlighter *nativeHighlighter = reinterpret_cast<TSHighlighter*>(highlighter);
+    if(nativeHighlighter->tree != nullptr) 
+        ts_tree_delete(nativeHighlighter->tree);
+    ts_query_cursor_delete(nativeHighlighter->cursor);
+    delete nativeHighlighter;
+}
+
+/**
+ * Apply the edits to the highlighted tree and move the cached spans below
+ * them, the edited rows are invalidated. The edits are 9 ints each, in the
+ * format of `reparse`.
+ */
+JNIEXPORT void JNICALL
+Java_io_github_module_treesitter_TreeSitter_highlighterEdit(JNIEnv* env, jobject thiz, 
+                                                            jlong highlighter, jintArray edits) {
+    TSHighlighter *nativeHighlighter = reinterpret_cast<TSHighlighter*>(highlighter);
+    if(nativeHighlighter->tree == nullptr) return;
+    
+    jsize editCount = env->GetArrayLength(edits) / 9;
+    jint *values = env->GetIntArrayElements(edits, nullptr);
+    for(jsize i=0; i < editCount; ++i) {
+        const jint *edit = values + i * 9;
+        TSInputEdit inputEdit {
+            static_cast<uint32_t>(edit[0]),
+            static_cast<uint32_t>(edit[1]),
+            static_cast<uint32_t>(edit[2]),
+            {static_cast<uint32_t>(edit[3]), static_cast<uint32_t>(edit[4])},
+            {static_cast<uint32_t>(edit[5]), static_cast<uint32_t>(edit[6])},
+            {static_cast<uint32_t>(edit[7]), static_cast<uint32_t>(edit[8])}
+        };
+        ts_tree_edit(nativeHighlighter->tree, &inputEdit);
+        
+        uint32_t startRow = inputEdit.start_point.row;
+        uint32_t oldEndRow = inputEdit.old_end_point.row;
+        uint32_t newEndRow = inputEdit.new_end_point.row;
+        std::vector<std::vector<HighlightSpan>> &rows = nativeHighlighter->rows;
+        std::vector<bool> &valid = nativeHighlighter->valid;
+        if(startRow >= rows.size()) continue;
+        
+        int64_t byteDelta = static_cast<int64_t>(inputEdit.new_end_byte) - inputEdit.old_end_byte;
+        int64_t rowDelta = static_cast<int64_t>(newEndRow) - oldEndRow;
+        
+        // the rows above the edit keep their spans, a span reaching past 
+        // the edit is shifted and a span ending inside the edit is stale
+        for(uint32_t row = 0; row < startRow; ++row) {
+            for(HighlightSpan &span : rows[row]) {
+                if(span.endByte <= inputEdit.start_byte) continue;
+                if(span.endByte < inputEdit.old_end_byte) {
+                    valid[row] = false;
+                    break;
+                }
+                span.endByte += byteDelta;
+            }
+            if(!valid[row]) rows[row].clear();
+        }
+        
+        // the rows below the edit keep their spans, shifted by the edit
+        std::vector<std::vector<HighlightSpan>> tail;
+        std::vector<bool> tailValid;
+        if(oldEndRow + 1 < rows.size()) {
+            tail.assign(
+                std::make_move_iterator(rows.begin() + oldEndRow + 1), 
+                std::make_move_iterator(rows.end())
+            );
+            tailValid.assign(valid.begin() + oldEndRow + 1, valid.end());
+        }
+        for(size_t row=0; row < tail.size(); ++row) {
+            for(HighlightSpan &span : tail[row]) {
+                // a span starting above the edit is stale
+                if(span.startRow <= oldEndRow) {
+                    tailValid[row] = false;
+                    break;
+                }
+                span.startByte += byteDelta;
+                span.endByte += byteDelta;
+                span.startRow += rowDelta;
+            }
+            if(!tailValid[row]) tail[row].clear();
+        }
+        
+        rows.resize(newEndRow + 1);
+        valid.resize(newEndRow + 1);
+        for(uint32_t row = startRow; row <= newEndRow; ++row) {
+            rows[row].clear();
+            valid[row] = false;
+        }
+        rows.insert(rows.end(), std::make_move_iterator(tail.begin()), std::make_move_iterator(tail.end()));
+        valid.insert(valid.end(), tailValid.begin(), tailValid.end());
+    }
+    env->ReleaseIntArrayElements(edits, values, JNI_ABORT);
+}
+
+/**
+ * Set the tree to highlight, usually the tree parsed after the edits. The
+ * rows of the ranges that changed since the previous tree are invalidated.
+ */
+JNIEXPORT void JNICALL
+Java_io_github_module_treesitter_TreeSitter_highlighterSetTree(JNIEnv* env, jobject thiz, 
+                                                               jlong highlighter, jlong tree) {
+    TSHighlighter *nativeHighlighter = reinterpret_cast<TSHighlighter*>(highlighter);
+    TSTree *newTree = ts_tree_copy(reinterpret_cast<TSTree*>(tree));
+    
+    if(nativeHighlighter->tree == nullptr) {
+        nativeHighlighter->rows.clear();
+        nativeHighlighter->valid.clear();
+    } else {
+        uint32_t length;
+        TSRange *ranges = ts_tree_get_changed_ranges(nativeHighlighter->tree, newTree, &length);
+        for(uint32_t i=0; i < length; ++i) 
+            invalidateRows(nativeHighlighter, ranges[i].start_point.row, ranges[i].end_point.row);
+        allocatorFree(ranges);
+        ts_tree_delete(nativeHighlighter->tree);
+    }
+    
+    nativeHighlighter->tree = newTree;
+}
+
+/**
+ * Get the highlight spans of the rows [startRow, endRow) as 3 ints each:
+ * start byte, end byte and capture id. Only the rows that are not cached are
+ * queried, the predicates are checked when a source is given.
+ */
+JNIEXPORT jintArray JNICALL
+Java_io_github_module_treesitter_TreeSitter_highlighterQuery(JNIEnv* env, jobject thiz, 
+                                                             jlong highlighter, jint startRow, jint endRow,
+                                                             jlong predicates, jbyteArray bytes, jobject charset) {
+    TSHighlighter *nativeHighlighter = reinterpret_cast<TSHighlighter*>(highlighter);
+    if(nativeHighlighter->tree == nullptr || endRow <= startRow) 
+        return env->NewIntArray(0);
+    
+    TSInputEncoding encoding = bytes != nullptr ? nativeEncoding(env, charset) : TSInputEncodingUTF8;
+    uint32_t lastRow = ts_node_end_point(ts_tree_root_node(nativeHighlighter->tree)).row + 1;
+    uint32_t start = std::min<uint32_t>(startRow, lastRow);
+    uint32_t end = std::min<uint32_t>(endRow, lastRow);
+    if(nativeHighlighter->rows.size() < end) {
+        nativeHighlighter->rows.resize(end);
+        nativeHighlighter->valid.resize(end, false);
+    }
+    
+    // query the runs of rows that are not cached
+    for(uint32_t row = start; row < end;) {
+        if(nativeHighlighter->valid[row]) {
+            row++;
+            continue;
+        }
+        uint32_t runEnd = row;
+        while(runEnd < end && !nativeHighlighter->valid[runEnd]) runEnd++;
+        queryRows(env, nativeHighlighter, row, runEnd, predicates, bytes, encoding);
+        row = runEnd;
+    }
+    
+    // a span covering several rows is returned by its first visible row
+    std::vector<jint> spans;
+    for(uint32_t row = start; row < end; ++row) {
+        for(const HighlightSpan &span : nativeHighlighter->rows[row]) {
+            if(span.startRow != row && !(row == start && span.startRow < start)) continue;
+            spans.push_back(span.startByte);
+            spans.push_back(span.endByte);
+            spans.push_back(span.capture);
+        }
+    }
+    
+    jintArray spanArray = env->NewIntArray(spans.size());
+    env->SetIntArrayRegion(spanArray, 0, spans.size(), spans.data());
+    return spanArray;
+}
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
@@ -14,7 +14,12 @@
  * limitations under the License.
  */
 
+#include <ctype.h>
+#include <dlfcn.h>
 #include <string.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include <tree_sitter/api.h>
 
 #include "jni_helper.h"
@@ -24,16 +29,209 @@
 extern "C" {
 #endif
 
+// the loaded languages keyed by the library path and the language name,
+// the libraries are never closed, a language lives as long as the process
+static std::mutex languageMutex;
+static std::unordered_map<std::string, const TSLanguage*> languages;
+
+// load the grammar library and resolve its `tree_sitter_<name>` function,
+// the library defaults to libtree-sitter-<name>.so on the library path
+static const TSLanguage *loadLanguage(const char *pathname, const char *name, std::string *error) {
+    std::string library = pathname != nullptr ? 
+        std::string(pathname) : "libtree-sitter-" + std::string(name) + ".so";
+    std::string key = library + ":" + name;
+    
+    std::lock_guard<std::mutex> lock(languageMutex);
+    auto entry = languages.find(key);
+    if(entry != languages.end())
+        return entry->second;
+    
+    void *handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if(handle == nullptr) {
+        *error = dlerror();
+        return nullptr;
+    }
+    
+    std::string symbol = "tree_sitter_" + std::string(name);
+    auto function = reinterpret_cast<const TSLanguage *(*)()>(dlsym(handle, symbol.c_str()));
+    if(function == nullptr) {
+        *error = dlerror();
+        dlclose(handle);
+        return nullptr;
+    }
+    
+    // an incompatible grammar would only fail later when a parser uses it
+    const TSLanguage *language = function();
+    uint32_t version = language != nullptr ? ts_language_version(language) : 0;
+    if(version < TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION || version > TREE_SITTER_LANGUAGE_VERSION) {
+        *error = symbol + " of " + library + " has the language version " + std::to_string(version)
+            + ", the supported versions are " + std::to_string(TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION)
+            + " to " + std::to_string(TREE_SITTER_LANGUAGE_VERSION);
+        dlclose(handle);
+        return nullptr;
+    }
+    
+    languages.emplace(key, language);
+    return language;
+}
+
+/**
+ * Get one of the languages by the class name, "C" is linked into the library,
+ * the others are loaded from libtree-sitter-<name>.so on demand. Returns 0 if
+ * the language is not available.
+ */
 JNIEXPORT jlong JNICALL
 Java_io_github_module_treesitter_TreeSitter_getSupportLanguage(JNIEnv* env, jobject thiz, jstring name) {
+    if(name == nullptr)
+        return 0;
     
     const char *language = env->GetStringUTFChars(name, nullptr);
+    std::string languageName(language);
     env->ReleaseStringUTFChars(name, language);
     
-    if(strcmp(language, "C") == 0)
+    if(languageName == "C")
         return reinterpret_cast<jlong>(tree_sitter_c());
-    else
-        return 0;
+    
+    for(char &c : languageName) 
+        c = tolower(c);
+    
+    std::string error;
+    const TSLanguage *result = loadLanguage(nullptr, languageName.c_str(), &error);
+    if(result == nullptr)
+        LOGE("Error: %s\n", error.c_str());
+    
+    return reinterpret_cast<jlong>(result);
+}
+
+/**
+ * Load the language `tree_sitter_<name>` from the given shared library, or
+ * from libtree-sitter-<name>.so if the path is null. The language is cached,
+ * loading it again is only a hash lookup. Throws an UnsatisfiedLinkError if
+ * the library or the symbol is missing, or the language version is not
+ * supported by this tree-sitter.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_loadLanguage(JNIEnv* env, jobject thiz, 
+                                                         jstring pathname, jstring name) {
+    const char *path = pathname != nullptr ? env->GetStringUTFChars(pathname, nullptr) : nullptr;
+    const char *languageName = env->GetStringUTFChars(name, nullptr);
+    
+    std::string error;
+    const TSLanguage *language = loadLanguage(path, languageName, &error);
+    
+    if(path != nullptr) env->ReleaseStringUTFChars(pathname, path);
+    env->ReleaseStringUTFChars(name, languageName);
+    
+    if(language == nullptr) {
+        jclass errorClass = env->FindClass("java/lang/UnsatisfiedLinkError");
+        env->ThrowNew(errorClass, error.c_str());
+        env->DeleteLocalRef(errorClass);
+    }
+    
+    return reinterpret_cast<jlong>(language);
+}
+
+/**
+ * Get the number of distinct node types in the language.
+ */
+JNIEXPORT jint JNICALL
+Java_io_github_module_treesitter_TreeSitter_languageSymbolCount(JNIEnv* env, jobject thiz, jlong language) {
+    return ts_language_symbol_count(reinterpret_cast<const TSLanguage*>(language));
+}
+
+/**
+ * Get the number of distinct field names in the language.
+ */
+JNIEXPORT jint JNICALL
+Java_io_github_module_treesitter_TreeSitter_languageFieldCount(JNIEnv* env, jobject thiz, jlong language) {
+    return ts_language_field_count(reinterpret_cast<const TSLanguage*>(language));
+}
+
+/**
+ * Get the ABI version number for this language. This version number is used
+ * to ensure that languages were generated by a compatible version of
+ * Tree-sitter.
+ *
+ * See also `ts_parser_set_language`.
+ */
+JNIEXPORT jint JNICALL
+Java_io_github_module_treesitter_TreeSitter_languageVersion(JNIEnv* env, jobject thiz, jlong language) {
+    return ts_language_version(reinterpret_cast<const TSLanguage*>(language));
+}
+
+/**
+ * Get the names of all of the node types, indexed by the numerical symbol id.
+ * The table is meant to be exported once per language.
+ */
+JNIEXPORT jobjectArray JNICALL
+Java_io_github_module_treesitter_TreeSitter_languageSymbolNames(JNIEnv* env, jobject thiz, jlong language) {
+    const TSLanguage *nativeLanguage = reinterpret_cast<const TSLanguage*>(language);
+    uint32_t count = ts_language_symbol_count(nativeLanguage);
+    
+    jclass stringClass = env->FindClass("java/lang/String");
+    jobjectArray nameArray = env->NewObjectArray(count, stringClass, nullptr);
+    for(uint32_t i=0; i < count; ++i) {
+        jstring name = env->NewStringUTF(ts_language_symbol_name(nativeLanguage, i));
+        env->SetObjectArrayElement(nameArray, i, name);
+        env->DeleteLocalRef(name);
+    }
+    
+    env->DeleteLocalRef(stringClass);
+    return nameArray;
+}
+
+/**
+ * Get the names of all of the fields, indexed by the numerical field id.
+ * The field ids start at 1, the element 0 is null.
+ */
+JNIEXPORT jobjectArray JNICALL
+Java_io_github_module_treesitter_TreeSitter_languageFieldNames(JNIEnv* env, jobject thiz, jlong language) {
+    const TSLanguage *nativeLanguage = reinterpret_cast<const TSLanguage*>(language);
+    uint32_t count = ts_language_field_count(nativeLanguage);
+    
+    jclass stringClass = env->FindClass("java/lang/String");
+    jobjectArray nameArray = env->NewObjectArray(count + 1, stringClass, nullptr);
+    for(uint32_t i=1; i <= count; ++i) {
+        jstring name = env->NewStringUTF(ts_language_field_name_for_id(nativeLanguage, i));
+        env->SetObjectArrayElement(nameArray, i, name);
+        env->DeleteLocalRef(name);
+    }
+    
+    env->DeleteLocalRef(stringClass);
+    return nameArray;
+}
+
+/**
+ * Get the numerical id for the given node type string.
+ */
+JNIEXPORT jint JNICALL
+Java_io_github_module_treesitter_TreeSitter_languageSymbolForName(JNIEnv* env, jobject thiz, jlong language, 
+                                                                  jstring name, jboolean isNamed) {
+    const char *symbol_name = env->GetStringUTFChars(name, nullptr);
+    TSSymbol symbol = ts_language_symbol_for_name(
+        reinterpret_cast<const TSLanguage*>(language),
+        symbol_name,
+        strlen(symbol_name),
+        isNamed
+    );
+    env->ReleaseStringUTFChars(name, symbol_name);
+    return symbol;
+}
+
+/**
+ * Get the numerical id for the given field name string.
+ */
+JNIEXPORT jint JNICALL
+Java_io_github_module_treesitter_TreeSitter_languageFieldIdForName(JNIEnv* env, jobject thiz, 
+                                                                   jlong language, jstring name) {
+    const char *field_name = env->GetStringUTFChars(name, nullptr);
+    TSFieldId field = ts_language_field_id_for_name(
+        reinterpret_cast<const TSLanguage*>(language),
+        field_name,
+        strlen(field_name)
+    );
+    env->ReleaseStringUTFChars(name, field_name);
+    return field;
 }
 
 #ifdef __cplusplus
@@ -23,20 +23,9 @@
 extern "C" {
 #endif
 
-TSLanguage *tree_sitter_bash();
-
+// the statically linked language, the others are loaded with dlopen
 TSLanguage *tree_sitter_c();
 
-TSLanguage *tree_sitter_cpp();
-
-TSLanguage *tree_sitter_java();
-
-TSLanguage *tree_sitter_kotlin();
-
-TSLanguage *tree_sitter_python();
-
-TSLanguage *tree_sitter_rust();
-
 #ifdef __cplusplus
 }
 #endif
@@ -14,8 +14,12 @@
  * limitations under the License.
  */
 
+#include <string.h>
+#include <algorithm>
 #include <tree_sitter/api.h>
 
+#include "ts_allocator.h"
+#include "ts_tree.h"
 #include "ts_utils.h"
 
 #ifdef __cplusplus
@@ -29,10 +33,12 @@ extern "C" {
  * freeing it using `free`.
  */
 JNIEXPORT jstring JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeString(JNIEnv* env, jobject thiz, jobject node) {
-    char *token = ts_node_string(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodeString(JNIEnv* env, jclass clazz, 
+                                                       jint context0, jint context1, jint context2, jint context3, 
+                                                       jlong id, jlong tree) {
+    char *token = ts_node_string(primitiveNode(context0, context1, context2, context3, id, tree));
     jstring text = env->NewStringUTF(token);
-    free(token);
+    allocatorFree(token);
     return text;
 }
 
@@ -40,24 +46,87 @@ Java_io_github_module_treesitter_TreeSitter_nodeString(JNIEnv* env, jobject thiz
  * Get the node's start byte.
  */
 JNIEXPORT jint JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeStartByte(JNIEnv* env, jobject thiz, jobject node) {
-    return ts_node_start_byte(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodeStartByte(JNIEnv* env, jclass clazz, 
+                                                          jint context0, jint context1, jint context2, jint context3, 
+                                                          jlong id, jlong tree) {
+    return ts_node_start_byte(primitiveNode(context0, context1, context2, context3, id, tree));
 }
 
 /**
  * Get the node's end byte.
  */
 JNIEXPORT jint JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeEndByte(JNIEnv* env, jobject thiz, jobject node) {
-    return ts_node_end_byte(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodeEndByte(JNIEnv* env, jclass clazz, 
+                                                        jint context0, jint context1, jint context2, jint context3, 
+                                                        jlong id, jlong tree) {
+    return ts_node_end_byte(primitiveNode(context0, context1, context2, context3, id, tree));
+}
+
+/**
+ * Get the node's text from the source retained by its tree, or null if the
+ * tree retains no source.
+ */
+JNIEXPORT jstring JNICALL
+Java_io_github_module_treesitter_TreeSitter_nodeText(JNIEnv* env, jclass clazz, jlong source,
+                                                     jint context0, jint context1, jint context2, jint context3, 
+                                                     jlong id, jlong tree) {
+    const TreeSource *treeText = treeSource(source);
+    if(treeText == nullptr) return nullptr;
+    
+    TSNode node = primitiveNode(context0, context1, context2, context3, id, tree);
+    std::vector<jchar> scratch;
+    return javaSourceText(env, treeText, ts_node_start_byte(node), ts_node_end_byte(node), &scratch);
+}
+
+/**
+ * Get the node's text bytes, in the encoding of the retained source, or
+ * null if the tree retains no source.
+ */
+JNIEXPORT jbyteArray JNICALL
+Java_io_github_module_treesitter_TreeSitter_nodeTextBytes(JNIEnv* env, jclass clazz, jlong source,
+                                                          jint context0, jint context1, jint context2, jint context3, 
+                                                          jlong id, jlong tree) {
+    const TreeSource *treeText = treeSource(source);
+    if(treeText == nullptr) return nullptr;
+    
+    TSNode node = primitiveNode(context0, context1, context2, context3, id, tree);
+    uint32_t end = std::min<size_t>(ts_node_end_byte(node), treeText->length());
+    uint32_t start = std::min(ts_node_start_byte(node), end);
+    jbyteArray byteArray = env->NewByteArray(end - start);
+    env->SetByteArrayRegion(byteArray, 0, end - start, reinterpret_cast<const jbyte*>(treeText->data() + start));
+    return byteArray;
+}
+
+/**
+ * Copy the node's text bytes into the direct buffer at the given offset.
+ *
+ * Returns the length of the text, the text is only copied if it fits the
+ * capacity. Returns -1 if the tree retains no source.
+ */
+JNIEXPORT jint JNICALL
+Java_io_github_module_treesitter_TreeSitter_nodeTextInto(JNIEnv* env, jclass clazz, jlong source,
+                                                         jint context0, jint context1, jint context2, jint context3, 
+                                                         jlong id, jlong tree, jobject buffer, jint offset, jint capacity) {
+    const TreeSource *treeText = treeSource(source);
+    char *address = static_cast<char*>(env->GetDirectBufferAddress(buffer));
+    if(treeText == nullptr || address == nullptr) return -1;
+    
+    TSNode node = primitiveNode(context0, context1, context2, context3, id, tree);
+    uint32_t end = std::min<size_t>(ts_node_end_byte(node), treeText->length());
+    uint32_t start = std::min(ts_node_start_byte(node), end);
+    if(end - start <= static_cast<uint32_t>(capacity))
+        memcpy(address + offset, treeText->data() + start, end - start);
+    return end - start;
 }
 
 /**
  * Get the node's start position in terms of rows and columns.
  */
 JNIEXPORT jobject JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeStartPoint(JNIEnv* env, jobject thiz, jobject node) {
-    TSPoint point = ts_node_start_point(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodeStartPoint(JNIEnv* env, jclass clazz, 
+                                                           jint context0, jint context1, jint context2, jint context3, 
+                                                           jlong id, jlong tree) {
+    TSPoint point = ts_node_start_point(primitiveNode(context0, context1, context2, context3, id, tree));
     return javaPoint(env, &point);
 }
 
@@ -65,8 +134,10 @@ Java_io_github_module_treesitter_TreeSitter_nodeStartPoint(JNIEnv* env, jobject
  * Get the node's end position in terms of rows and columns.
  */
 JNIEXPORT jobject JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeEndPoint(JNIEnv* env, jobject thiz, jobject node) {
-    TSPoint point = ts_node_end_point(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodeEndPoint(JNIEnv* env, jclass clazz, 
+                                                         jint context0, jint context1, jint context2, jint context3, 
+                                                         jlong id, jlong tree) {
+    TSPoint point = ts_node_end_point(primitiveNode(context0, context1, context2, context3, id, tree));
     return javaPoint(env, &point);
 }
 
@@ -74,8 +145,10 @@ Java_io_github_module_treesitter_TreeSitter_nodeEndPoint(JNIEnv* env, jobject th
  * Get the node's type as a null-terminated string.
  */
 JNIEXPORT jstring JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeType(JNIEnv* env, jobject thiz, jobject node) {
-    const char* type = ts_node_type(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodeType(JNIEnv* env, jclass clazz, 
+                                                     jint context0, jint context1, jint context2, jint context3, 
+                                                     jlong id, jlong tree) {
+    const char* type = ts_node_type(primitiveNode(context0, context1, context2, context3, id, tree));
     return env->NewStringUTF(type);
 }
 
@@ -83,16 +156,20 @@ Java_io_github_module_treesitter_TreeSitter_nodeType(JNIEnv* env, jobject thiz,
  * Get the node's type as a numerical id.
  */
 JNIEXPORT jint JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeSymbol(JNIEnv* env, jobject thiz, jobject node) {
-    return ts_node_symbol(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodeSymbol(JNIEnv* env, jclass clazz, 
+                                                       jint context0, jint context1, jint context2, jint context3, 
+                                                       jlong id, jlong tree) {
+    return ts_node_symbol(primitiveNode(context0, context1, context2, context3, id, tree));
 }
 
 /**
  * Get the node's number of children.
  */
 JNIEXPORT jint JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeChildCount(JNIEnv* env, jobject thiz, jobject node) {
-    return ts_node_child_count(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodeChildCount(JNIEnv* env, jclass clazz, 
+                                                           jint context0, jint context1, jint context2, jint context3, 
+                                                           jlong id, jlong tree) {
+    return ts_node_child_count(primitiveNode(context0, context1, context2, context3, id, tree));
 }
 
 /**
@@ -101,8 +178,21 @@ Java_io_github_module_treesitter_TreeSitter_nodeChildCount(JNIEnv* env, jobject
  * See also `ts_node_is_named`.
  */
 JNIEXPORT jint JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeNamedChildCount(JNIEnv* env, jobject thiz, jobject node) {
-    return ts_node_named_child_count(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodeNamedChildCount(JNIEnv* env, jclass clazz, 
+                                                                jint context0, jint context1, jint context2, jint context3, 
+                                                                jlong id, jlong tree) {
+    return ts_node_named_child_count(primitiveNode(context0, context1, context2, context3, id, tree));
+}
+
+/**
+ * Get the node's immediate parent.
+ */
+JNIEXPORT jobject JNICALL
+Java_io_github_module_treesitter_TreeSitter_nodeParent(JNIEnv* env, jclass clazz, 
+                                                       jint context0, jint context1, jint context2, jint context3, 
+                                                       jlong id, jlong tree) {
+    TSNode tree_node = ts_node_parent(primitiveNode(context0, context1, context2, context3, id, tree));
+    return javaNode(env, &tree_node);
 }
 
 /**
@@ -110,9 +200,10 @@ Java_io_github_module_treesitter_TreeSitter_nodeNamedChildCount(JNIEnv* env, job
  * child.
  */
 JNIEXPORT jobject JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeChildAt(JNIEnv* env, jobject thiz, 
-                                                        jobject node, jint index) {
-    TSNode tree_node = ts_node_child(nativeNode(env, node), index);
+Java_io_github_module_treesitter_TreeSitter_nodeChildAt(JNIEnv* env, jclass clazz, 
+                                                        jint context0, jint context1, jint context2, jint context3, 
+                                                        jlong id, jlong tree, jint index) {
+    TSNode tree_node = ts_node_child(primitiveNode(context0, context1, context2, context3, id, tree), index);
     return javaNode(env, &tree_node);
 }
 
@@ -122,9 +213,10 @@ Java_io_github_module_treesitter_TreeSitter_nodeChildAt(JNIEnv* env, jobject thi
  * See also `ts_node_is_named`.
  */
 JNIEXPORT jobject JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeNamedChildAt(JNIEnv* env, jobject thiz, 
-                                                             jobject node, jint index) {
-    TSNode tree_node = ts_node_named_child(nativeNode(env, node), index);
+Java_io_github_module_treesitter_TreeSitter_nodeNamedChildAt(JNIEnv* env, jclass clazz, 
+                                                             jint context0, jint context1, jint context2, jint context3, 
+                                                             jlong id, jlong tree, jint index) {
+    TSNode tree_node = ts_node_named_child(primitiveNode(context0, context1, context2, context3, id, tree), index);
     return javaNode(env, &tree_node);
 }
 
@@ -132,14 +224,18 @@ Java_io_github_module_treesitter_TreeSitter_nodeNamedChildAt(JNIEnv* env, jobjec
  * Get the node's next / previous sibling.
  */
 JNIEXPORT jobject JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodePrevSibling(JNIEnv* env, jobject thiz, jobject node) {
-    TSNode tree_node = ts_node_prev_sibling(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodePrevSibling(JNIEnv* env, jclass clazz, 
+                                                            jint context0, jint context1, jint context2, jint context3, 
+                                                            jlong id, jlong tree) {
+    TSNode tree_node = ts_node_prev_sibling(primitiveNode(context0, context1, context2, context3, id, tree));
     return javaNode(env, &tree_node);
 }
 
 JNIEXPORT jobject JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeNextSibling(JNIEnv* env, jobject thiz, jobject node) {
-    TSNode tree_node = ts_node_next_sibling(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodeNextSibling(JNIEnv* env, jclass clazz, 
+                                                            jint context0, jint context1, jint context2, jint context3, 
+                                                            jlong id, jlong tree) {
+    TSNode tree_node = ts_node_next_sibling(primitiveNode(context0, context1, context2, context3, id, tree));
     return javaNode(env, &tree_node);
 }
 
@@ -147,14 +243,18 @@ Java_io_github_module_treesitter_TreeSitter_nodeNextSibling(JNIEnv* env, jobject
  * Get the node's next / previous *named* sibling.
  */
 JNIEXPORT jobject JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodePrevNamedSibling(JNIEnv* env, jobject thiz, jobject node) {
-    TSNode tree_node = ts_node_prev_named_sibling(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodePrevNamedSibling(JNIEnv* env, jclass clazz, 
+                                                                 jint context0, jint context1, jint context2, jint context3, 
+                                                                 jlong id, jlong tree) {
+    TSNode tree_node = ts_node_prev_named_sibling(primitiveNode(context0, context1, context2, context3, id, tree));
     return javaNode(env, &tree_node);
 }
 
 JNIEXPORT jobject JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeNextNamedSibling(JNIEnv* env, jobject thiz, jobject node) {
-    TSNode tree_node = ts_node_next_named_sibling(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodeNextNamedSibling(JNIEnv* env, jclass clazz, 
+                                                                 jint context0, jint context1, jint context2, jint context3, 
+                                                                 jlong id, jlong tree) {
+    TSNode tree_node = ts_node_next_named_sibling(primitiveNode(context0, context1, context2, context3, id, tree));
     return javaNode(env, &tree_node);
 }
 
@@ -162,22 +262,39 @@ Java_io_github_module_treesitter_TreeSitter_nodeNextNamedSibling(JNIEnv* env, jo
  * Get the node's child with the given field name.
  */
 JNIEXPORT jobject JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeChildByFieldName(JNIEnv* env, jobject thiz, 
-                                                                 jobject node, jstring name, jint length) {
+Java_io_github_module_treesitter_TreeSitter_nodeChildByFieldName(JNIEnv* env, jclass clazz, 
+                                                                 jint context0, jint context1, jint context2, jint context3, 
+                                                                 jlong id, jlong tree, jstring name, jint length) {
     const char *field_name = env->GetStringUTFChars(name, nullptr);
-    TSNode tree_node = ts_node_child_by_field_name(nativeNode(env, node), field_name, length);
+    TSNode tree_node = ts_node_child_by_field_name(primitiveNode(context0, context1, context2, context3, id, tree), field_name, length);
     env->ReleaseStringUTFChars(name, field_name);
     return javaNode(env, &tree_node);
 }
 
+/**
+ * Get the node's child with the given numerical field id.
+ *
+ * You can convert a field name to an id using the
+ * `ts_language_field_id_for_name` function.
+ */
+JNIEXPORT jobject JNICALL
+Java_io_github_module_treesitter_TreeSitter_nodeChildByFieldId(JNIEnv* env, jclass clazz, 
+                                                               jint context0, jint context1, jint context2, jint context3, 
+                                                               jlong id, jlong tree, jint fieldId) {
+    TSNode tree_node = ts_node_child_by_field_id(primitiveNode(context0, context1, context2, context3, id, tree), fieldId);
+    return javaNode(env, &tree_node);
+}
+
 /**
  * Check if the node is *named*. Named nodes correspond to named rules in the
  * grammar, whereas *anonymous* nodes correspond to string literals in the
  * grammar.
  */
 JNIEXPORT jboolean JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeIsNamed(JNIEnv* env, jobject thiz, jobject node) {
-    return ts_node_is_named(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodeIsNamed(JNIEnv* env, jclass clazz, 
+                                                        jint context0, jint context1, jint context2, jint context3, 
+                                                        jlong id, jlong tree) {
+    return ts_node_is_named(primitiveNode(context0, context1, context2, context3, id, tree));
 }
 
 /**
@@ -186,13 +303,17 @@ Java_io_github_module_treesitter_TreeSitter_nodeIsNamed(JNIEnv* env, jobject thi
  * was found.
  */
 JNIEXPORT jboolean JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeIsNull(JNIEnv* env, jobject thiz, jobject node) {
-    return ts_node_is_null(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodeIsNull(JNIEnv* env, jclass clazz, 
+                                                       jint context0, jint context1, jint context2, jint context3, 
+                                                       jlong id, jlong tree) {
+    return ts_node_is_null(primitiveNode(context0, context1, context2, context3, id, tree));
 }
 
 JNIEXPORT jboolean JNICALL
-Java_io_github_module_treesitter_TreeSitter_nodeHasError(JNIEnv* env, jobject thiz, jobject node) {
-    return ts_node_has_error(nativeNode(env, node));
+Java_io_github_module_treesitter_TreeSitter_nodeHasError(JNIEnv* env, jclass clazz, 
+                                                         jint context0, jint context1, jint context2, jint context3, 
+                                                         jlong id, jlong tree) {
+    return ts_node_has_error(primitiveNode(context0, context1, context2, context3, id, tree));
 }
 
 JNIEXPORT jboolean JNICALL
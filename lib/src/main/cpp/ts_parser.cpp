@@ -14,14 +14,27 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
 #include <tree_sitter/api.h>
 
 #include "jni_helper.h"
+#include "ts_allocator.h"
+#include "ts_tree.h"
+#include "ts_utils.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -33,28 +46,180 @@ jclass javaTSParserClass = nullptr;
 jclass javaTSPointClass = nullptr;
 jclass javaTSLogTypeClass = nullptr;
 jclass javaTSInputEncoding = nullptr;
+jclass javaTSInputReaderClass = nullptr;
+jclass javaTSLoggerClass = nullptr;
+jclass javaTSBufferReaderClass = nullptr;
 
 // callbacks
-jmethodID read = nullptr;
+jmethodID reader = nullptr;
+jmethodID bufferReader = nullptr;
 jmethodID logger = nullptr;
 
-static jbyteArray bytes = nullptr;
-static jbyte *chunks = nullptr;
+// the size of the native buffer filled by the java TSBufferReader
+#define INPUT_BUFFER_SIZE (64 * 1024)
+
+// the state of one parserParse call, passed as the TSInput payload
+struct TSInputPayload {
+    JNIEnv *env;
+    // java TSInputReader
+    jobject reader;
+    // the chunk currently read by the parser
+    jbyteArray bytes;
+    jbyte *chunks;
+};
+
+// the state of one parserParseBuffer call, passed as the TSInput payload
+struct TSBufferPayload {
+    JNIEnv *env;
+    // java TSBufferReader
+    jobject reader;
+    // direct ByteBuffer wrapping the data, reused for every chunk
+    jobject buffer;
+    char *data;
+};
+
+// the native state owned by a parser, stored as the payload of its logger, 
+// the logger function is only set while there is a java logger
+struct TSParserState {
+    // java TSLogger
+    jobject logger;
+    // the input buffer of parserParseBuffer and the direct ByteBuffer 
+    // wrapping it, kept for the next parse
+    char *inputBuffer;
+    jobject inputBufferObject;
+    // the arena the parser and its trees are allocated from, see newArenaParser
+    void *arena;
+};
+
+// the state of the parser, created on the first use
+static TSParserState *parserState(TSParser *parser) {
+    TSLogger current = ts_parser_logger(parser);
+    if(current.payload != nullptr) 
+        return static_cast<TSParserState*>(current.payload);
+    
+    TSParserState *state = new TSParserState {nullptr, nullptr, nullptr, nullptr};
+    ts_parser_set_logger(parser, {state, nullptr});
+    return state;
+}
+
+// the arena of the parser, null for a parser allocating from the heap
+static void *parserArena(TSParser *parser) {
+    TSParserState *state = static_cast<TSParserState*>(ts_parser_logger(parser).payload);
+    return state != nullptr ? state->arena : nullptr;
+}
+
+// a parser of an arena only parses while its arena is the innermost 
+// arena of the calling thread, throws an IllegalStateException otherwise
+static bool checkParserArena(JNIEnv *env, TSParser *parser) {
+    void *arena = parserArena(parser);
+    if(arena == nullptr || arena == currentThreadArena()) return true;
+    env->ThrowNew(javaIllegalStateExceptionClass, "the arena of the parser is not the innermost arena of this thread");
+    return false;
+}
+
+// the allocations of a parse are counted as the parser, the blocks that end 
+// up in the new tree are counted as the tree once the parse returns. A parser 
+// of an arena allocates from its arena and the new tree is owned by the arena
+struct ParseScope {
+    explicit ParseScope(TSParser *parser) : 
+        arena(parserArena(parser)), arenaScope(arena), kindScope(MEMORY_KIND_PARSER) {}
+    
+    TSTree *finish(TSTree *tree) {
+        if(tree == nullptr) return tree;
+        if(arena == nullptr) 
+            retagTree(tree);
+        else
+            retainArena(arena);
+        return tree;
+    }
+    
+    void *arena;
+    ArenaScope arenaScope;
+    KindScope kindScope;
+};
+
+// release the chunk read by the previous callback
+static void releaseInputChunk(TSInputPayload *input) {
+    if(input->bytes != nullptr) {
+        if(input->chunks != nullptr)
+            input->env->ReleaseByteArrayElements(input->bytes, input->chunks, JNI_ABORT);
+        input->env->DeleteLocalRef(input->bytes);
+    }
+    input->bytes = nullptr;
+    input->chunks = nullptr;
+}
+
+// release the java logger owned by the parser, the rest of the 
+// state is kept, also used by the parser pool
+void releaseParserLogger(JNIEnv *env, TSParser *parser) {
+    TSLogger current = ts_parser_logger(parser);
+    if(current.payload == nullptr) return;
+    
+    TSParserState *state = static_cast<TSParserState*>(current.payload);
+    if(state->logger != nullptr) {
+        env->DeleteGlobalRef(state->logger);
+        state->logger = nullptr;
+    }
+    ts_parser_set_logger(parser, {state, nullptr});
+}
+
+// delete the parser and its state, also used by the parser pool
+void deleteParserState(JNIEnv *env, TSParser *parser) {
+    TSLogger current = ts_parser_logger(parser);
+    TSParserState *state = static_cast<TSParserState*>(current.payload);
+    ts_parser_delete(parser);
+    if(state == nullptr) return;
+    
+    if(state->arena != nullptr)
+        releaseArena(state->arena);
+    if(state->logger != nullptr) 
+        env->DeleteGlobalRef(state->logger);
+    if(state->inputBufferObject != nullptr) 
+        env->DeleteGlobalRef(state->inputBufferObject);
+    free(state->inputBuffer);
+    delete state;
+}
 
 /**
  * Create a new parser.
  */
 JNIEXPORT jlong JNICALL
 Java_io_github_module_treesitter_TreeSitter_newParser(JNIEnv* env, jobject thiz) {
+    KindScope scope(MEMORY_KIND_PARSER);
     return reinterpret_cast<jlong>(ts_parser_new());
 }
 
+/**
+ * Create a new parser allocating from the arena, the trees that it parses are
+ * allocated from the arena too. The arena must be the innermost arena of the
+ * calling thread, and it can not end until the parser and its trees are
+ * deleted.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_newArenaParser(JNIEnv* env, jobject thiz, jlong arena) {
+    void *nativeArena = reinterpret_cast<void*>(arena);
+    if(nativeArena != currentThreadArena()) {
+        env->ThrowNew(javaIllegalStateExceptionClass, "the arena is not the innermost arena of this thread");
+        return 0;
+    }
+    
+    TSParser *parser;
+    {
+        ArenaScope arenaScope(nativeArena);
+        KindScope scope(MEMORY_KIND_PARSER);
+        parser = ts_parser_new();
+    }
+    parserState(parser)->arena = nativeArena;
+    retainArena(nativeArena);
+    return reinterpret_cast<jlong>(parser);
+}
+
 /**
  * Delete the parser, freeing all of the memory that it used.
  */
 JNIEXPORT void JNICALL
 Java_io_github_module_treesitter_TreeSitter_deleteParser(JNIEnv* env, jobject thiz, jlong parser) {
-    ts_parser_delete(reinterpret_cast<TSParser*>(parser));
+    deleteParserState(env, reinterpret_cast<TSParser*>(parser));
 }
 
 /**
@@ -109,51 +274,88 @@ Java_io_github_module_treesitter_TreeSitter_getParserLanguage(JNIEnv* env, jobje
  * owned by the previous logger.
  */
 JNIEXPORT void JNICALL
-Java_io_github_module_treesitter_TreeSitter_setParserLogger(JNIEnv* env, jobject thiz, jlong parser) {                                                    
+Java_io_github_module_treesitter_TreeSitter_setParserLogger(JNIEnv* env, jobject thiz, 
+                                                            jlong parser, jobject loggerObject) {
+    // release the previous logger
+    releaseParserLogger(env, reinterpret_cast<TSParser*>(parser));
+    
+    if(loggerObject == nullptr)
+        return;
     
     // convert lambda to C-Style function pointer
     auto callback = [](void *payload, TSLogType type, const char *message) {
-        // local JNIEnv pointer
-        JNIEnv *localEnv = static_cast<JNIEnv*>(payload);
-        jfieldID field = nullptr;
-        switch(type) {
-            case TSLogTypeParse:
-                field = localEnv->GetStaticFieldID(
-                    javaTSLogTypeClass, 
-                    "PARSE", 
-                    "Lio/github/module/treesitter/TSLogType;"
-                );
-                break;
-            case TSLogTypeLex:
-                field = localEnv->GetStaticFieldID(
-                    javaTSLogTypeClass, 
-                    "LEX", 
-                    "Lio/github/module/treesitter/TSLogType;"
-                );
-                break;
-            default:
-                LOGE("Error: Unknown field %d of TSLogType class\n", type);
-                break;
-        }
-           
+        // the parser may run on any attached thread, so do not capture the env
+        JNIEnv *localEnv = getEnv();
+        // a previous log call has thrown
+        if(localEnv->ExceptionCheck())
+            return;
+        
         // java enum TSLogType object
-        jobject typeObject = localEnv->GetStaticObjectField(javaTSLogTypeClass, field);
+        jobject typeObject = javaTSLogTypes[type];
+        jstring messageObject = localEnv->NewStringUTF(message);
         // call the kotlin lambda expression
-        localEnv->CallStaticVoidMethod(
-            javaTSParserClass,
+        localEnv->CallVoidMethod(
+            static_cast<TSParserState*>(payload)->logger,
             logger,
             typeObject,
-            localEnv->NewStringUTF(message)
+            messageObject
         );
-    };
         
-    ts_parser_set_logger(
-        reinterpret_cast<TSParser*>(parser), 
-        {env, callback}
-    );
+        localEnv->DeleteLocalRef(messageObject);
+    };
+    
+    // the logger object is owned by the parser until it is replaced or deleted
+    TSParserState *state = parserState(reinterpret_cast<TSParser*>(parser));
+    state->logger = env->NewGlobalRef(loggerObject);
+    ts_parser_set_logger(reinterpret_cast<TSParser*>(parser), {state, callback});
 }
 
 
+/**
+ * Set the ranges of text that the parser should include when parsing.
+ *
+ * By default, the parser will always include entire documents. This function
+ * allows you to parse only a *portion* of a document but still return a syntax
+ * tree whose ranges match up with the document as a whole. You can also pass
+ * multiple disjoint ranges.
+ *
+ * The given ranges must be ordered from earliest to latest in the document,
+ * and they must not overlap. That is, the following must hold for all
+ * `i` < `length - 1`: ranges[i].end_byte <= ranges[i + 1].start_byte
+ *
+ * The ranges are a flat array of 6 ints each: start byte, end byte, start
+ * row, start column, end row and end column. An empty array includes the
+ * entire document.
+ *
+ * If this requirement is not satisfied, the operation will fail, the ranges
+ * will not be assigned, and this function will return `false`. On success,
+ * this function returns `true`
+ */
+JNIEXPORT jboolean JNICALL
+Java_io_github_module_treesitter_TreeSitter_setParserIncludedRanges(JNIEnv* env, jobject thiz, 
+                                                                    jlong parser, jintArray ranges) {
+    jsize count = env->GetArrayLength(ranges) / 6;
+    std::vector<TSRange> nativeRanges(count);
+    
+    jint *values = env->GetIntArrayElements(ranges, nullptr);
+    for(jsize i=0; i < count; ++i) {
+        const jint *range = values + i * 6;
+        nativeRanges[i] = TSRange {
+            {static_cast<uint32_t>(range[2]), static_cast<uint32_t>(range[3])},
+            {static_cast<uint32_t>(range[4]), static_cast<uint32_t>(range[5])},
+            static_cast<uint32_t>(range[0]),
+            static_cast<uint32_t>(range[1])
+        };
+    }
+    env->ReleaseIntArrayElements(ranges, values, JNI_ABORT);
+    
+    return ts_parser_set_included_ranges(
+        reinterpret_cast<TSParser*>(parser),
+        count > 0 ? nativeRanges.data() : nullptr,
+        count
+    );
+}
+
 /**
  * Set the maximum duration in microseconds that parsing should be allowed to
  * take before halting.
@@ -216,90 +418,601 @@ Java_io_github_module_treesitter_TreeSitter_getParserCancellationFlag(JNIEnv* en
 }
 
 
+/**
+ * Use the parser to parse some source code and create a syntax tree.
+ *
+ * The text is read chunk by chunk through the `read` method of the given
+ * java reader object. All of the state of a parse lives in its own payload,
+ * so parsers may run concurrently on different threads.
+ */
 JNIEXPORT jlong JNICALL
 Java_io_github_module_treesitter_TreeSitter_parserParse(JNIEnv* env, jobject thiz,
-                                                        jlong parser, jlong oldTree, jobject charset) {
-    // get the text encoding                                       
-    jclass javaTSInputEncoding = env->FindClass("io/github/module/treesitter/TSInputEncoding");
-    jmethodID ordinal = env->GetMethodID(javaTSInputEncoding, "ordinal", "()I");
-    TSInputEncoding encoding = static_cast<TSInputEncoding>(env->CallIntMethod(charset, ordinal));
-   
-    // reinitialize jbytes
-    ::bytes = nullptr; 
-    ::chunks = nullptr;
+                                                        jlong parser, jlong oldTree, 
+                                                        jobject readerObject, jobject charset) {
+    if(!checkParserArena(env, reinterpret_cast<TSParser*>(parser))) return 0;
+
+    // get the text encoding
+    TSInputEncoding encoding = nativeEncoding(env, charset);
+    
+    TSInputPayload payload {env, readerObject, nullptr, nullptr};
    
     // convert lambda to C-Style function pointer
     auto callback = [](
         void *payload, uint32_t byte_index, TSPoint point, uint32_t *bytes_read
     ) -> const char* {
-        // local JNIEnv pointer
-        JNIEnv *localEnv = static_cast<JNIEnv*>(payload);
+        TSInputPayload *input = static_cast<TSInputPayload*>(payload);
+        JNIEnv *localEnv = input->env;
+        
+        // free the memory of the previous chunk
+        releaseInputChunk(input);
         
-        // free the memory of the previous row
-        if(bytes != nullptr && chunks != nullptr) {
-            localEnv->ReleaseByteArrayElements(bytes, chunks, JNI_ABORT);
+        // a previous read has thrown, end the input
+        if(localEnv->ExceptionCheck()) {
+            *bytes_read = 0;
+            return "";
         }
-            
-        // java TSPoint constructor
-        jmethodID constructor = localEnv->GetMethodID(javaTSPointClass, "<init>", "(II)V");
-        jobject position = localEnv->NewObject(javaTSPointClass, constructor, point.row, point.column);
         
-        // jstring to jbyte array
-        bytes = reinterpret_cast<jbyteArray>(
-            localEnv->CallStaticObjectMethod(javaTSParserClass, read, byte_index, position)
+        // the chunk of text starting at the given position
+        input->bytes = reinterpret_cast<jbyteArray>(
+            localEnv->CallObjectMethod(input->reader, reader, byte_index, point.row, point.column)
         );
-        chunks = localEnv->GetByteArrayElements(bytes, nullptr);
-            
+        
+        if(input->bytes == nullptr || localEnv->ExceptionCheck()) {
+            // a pending exception is thrown once the parse returns
+            *bytes_read = 0;
+            return "";
+        }
+        
+        input->chunks = localEnv->GetByteArrayElements(input->bytes, nullptr);
         // reset bytes_read
-        *bytes_read = localEnv->GetArrayLength(bytes);
+        *bytes_read = localEnv->GetArrayLength(input->bytes);
             
-        return reinterpret_cast<const char*>(chunks);
+        return reinterpret_cast<const char*>(input->chunks);
     };
     
-    TSTree *tree = ts_parser_parse(
+    ParseScope scope(reinterpret_cast<TSParser*>(parser));
+    TSTree *tree = scope.finish(ts_parser_parse(
         reinterpret_cast<TSParser*>(parser),
         reinterpret_cast<TSTree*>(oldTree),
-        {env, callback, encoding}
-    );
+        {&payload, callback, encoding}
+    ));
     
-    env->DeleteLocalRef(javaTSInputEncoding);
+    releaseInputChunk(&payload);
             
     return reinterpret_cast<jlong>(tree);
 }
 
+/**
+ * Use the parser to parse some source code and create a syntax tree.
+ *
+ * The parser owns a fixed size native buffer, exposed to java as a direct
+ * `ByteBuffer`. The `read` method of the java reader fills it with the text
+ * starting at the requested byte and returns the number of bytes written, so
+ * reading a chunk allocates nothing on either side. The buffer is created on
+ * the first call and kept by the parser for the next parses, returns 0 if it
+ * cannot be allocated.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_parserParseBuffer(JNIEnv* env, jobject thiz,
+                                                              jlong parser, jlong oldTree, 
+                                                              jobject readerObject, jobject charset) {
+    if(!checkParserArena(env, reinterpret_cast<TSParser*>(parser))) return 0;
+
+    // get the text encoding
+    TSInputEncoding encoding = nativeEncoding(env, charset);
+    
+    TSParserState *state = parserState(reinterpret_cast<TSParser*>(parser));
+    if(state->inputBuffer == nullptr) {
+        char *data = static_cast<char*>(malloc(INPUT_BUFFER_SIZE));
+        jobject bufferObject = data != nullptr ? env->NewDirectByteBuffer(data, INPUT_BUFFER_SIZE) : nullptr;
+        if(bufferObject == nullptr) {
+            LOGE("Error: %s\n", "Failed to allocate the input buffer");
+            free(data);
+            return 0;
+        }
+        state->inputBuffer = data;
+        state->inputBufferObject = env->NewGlobalRef(bufferObject);
+        env->DeleteLocalRef(bufferObject);
+    }
+    
+    TSBufferPayload payload {
+        env, 
+        readerObject, 
+        state->inputBufferObject, 
+        state->inputBuffer
+    };
+    
+    // convert lambda to C-Style function pointer
+    auto callback = [](
+        void *payload, uint32_t byte_index, TSPoint point, uint32_t *bytes_read
+    ) -> const char* {
+        TSBufferPayload *input = static_cast<TSBufferPayload*>(payload);
+        JNIEnv *localEnv = input->env;
+        
+        // a previous read has thrown, end the input
+        if(localEnv->ExceptionCheck()) {
+            *bytes_read = 0;
+            return "";
+        }
+        
+        jint count = localEnv->CallIntMethod(input->reader, bufferReader, byte_index, input->buffer);
+        
+        if(localEnv->ExceptionCheck() || count <= 0) {
+            *bytes_read = 0;
+            return "";
+        }
+        
+        *bytes_read = count < INPUT_BUFFER_SIZE ? count : INPUT_BUFFER_SIZE;
+        return input->data;
+    };
+    
+    ParseScope scope(reinterpret_cast<TSParser*>(parser));
+    TSTree *tree = scope.finish(ts_parser_parse(
+        reinterpret_cast<TSParser*>(parser),
+        reinterpret_cast<TSTree*>(oldTree),
+        {&payload, callback, encoding}
+    ));
+    
+    return reinterpret_cast<jlong>(tree);
+}
+
 /**
  * Use the parser to parse some source code stored in one contiguous buffer with
  * a given encoding. The first four parameters work the same as in the
  * `ts_parser_parse_string` method above. The final parameter indicates whether
  * the text is encoded as UTF8 or UTF16.
+ *
+ * If `source` is given the tree keeps a copy of the bytes, the handle of the
+ * copy is written to `source[0]` and the node texts are read from it.
  */
 JNIEXPORT jlong JNICALL
 Java_io_github_module_treesitter_TreeSitter_parseString(JNIEnv* env, jobject thiz,
-                                                        jlong parser, jlong oldTree, 
-                                                        jbyteArray bytes, jobject charset) {
-    
-    jclass javaTSInputEncoding = env->FindClass("io/github/module/treesitter/TSInputEncoding");
-    jmethodID ordinal = env->GetMethodID(javaTSInputEncoding, "ordinal", "()I");
+                                                        jlong parser, jlong oldTree, jbyteArray bytes, 
+                                                        jobject charset, jlongArray source) {
+    if(!checkParserArena(env, reinterpret_cast<TSParser*>(parser))) return 0;
     
-    TSInputEncoding encoding = static_cast<TSInputEncoding>(env->CallIntMethod(charset, ordinal));
+    // get the text encoding
+    TSInputEncoding encoding = nativeEncoding(env, charset);
     
-    jbyte* source = env->GetByteArrayElements(bytes, NULL);
+    jbyte* data = env->GetByteArrayElements(bytes, NULL);
     size_t length = env->GetArrayLength(bytes);
     
-    TSTree *tree = ts_parser_parse_string_encoding(
+    ParseScope scope(reinterpret_cast<TSParser*>(parser));
+    TSTree *tree = scope.finish(ts_parser_parse_string_encoding(
         reinterpret_cast<TSParser*>(parser),
         reinterpret_cast<TSTree*>(oldTree),
-        reinterpret_cast<const char*>(source),
+        reinterpret_cast<const char*>(data),
         length,
         encoding
+    ));
+    
+    // the tree keeps its own copy of the source
+    if(tree != nullptr && source != nullptr) {
+        std::shared_ptr<TreeSource> treeSource = std::make_shared<TreeSource>();
+        treeSource->text.assign(reinterpret_cast<const char*>(data), length);
+        treeSource->encoding = encoding;
+        storeTreeSource(env, source, 0, std::move(treeSource));
+    }
+    
+    env->ReleaseByteArrayElements(bytes, data, JNI_ABORT);
+    
+    return reinterpret_cast<jlong>(tree);
+}
+
+/**
+ * Use the parser to parse the characters of a java string as UTF16.
+ *
+ * The string is pinned with `GetStringCritical` when the parser has no logger,
+ * otherwise or when the string can not be pinned the characters are copied 
+ * with `GetStringRegion` into a buffer freed after the parse, so the text is
+ * never transcoded into a new byte array. The code units are in the native byte order, which is the
+ * little endian order that tree-sitter reads on our targets.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_parseChars(JNIEnv* env, jobject thiz,
+                                                       jlong parser, jlong oldTree, 
+                                                       jstring text, jlongArray source) {
+    if(!checkParserArena(env, reinterpret_cast<TSParser*>(parser))) return 0;
+
+    TSParser *nativeParser = reinterpret_cast<TSParser*>(parser);
+    bool critical = ts_parser_logger(nativeParser).log == nullptr;
+    jsize length = env->GetStringLength(text);
+    
+    // the copy of the characters lives as long as the parse, a buffer kept by 
+    // the thread would pin the largest document on every thread
+    std::vector<jchar> chars;
+    const jchar *data = nullptr;
+    if(critical) {
+        data = env->GetStringCritical(text, nullptr);
+        if(data == nullptr) {
+            // the string could not be pinned, copy the characters instead
+            if(env->ExceptionCheck()) env->ExceptionClear();
+            critical = false;
+        }
+    }
+    
+    if(!critical) {
+        chars.resize(length);
+        env->GetStringRegion(text, 0, length, chars.data());
+        data = chars.data();
+    }
+    
+    ParseScope scope(nativeParser);
+    TSTree *tree = scope.finish(ts_parser_parse_string_encoding(
+        nativeParser,
+        reinterpret_cast<TSTree*>(oldTree),
+        reinterpret_cast<const char*>(data),
+        length * sizeof(jchar),
+        TSInputEncodingUTF16
+    ));
+    
+    // the tree keeps its own copy of the source, the handle is 
+    // stored after the string is released
+    std::shared_ptr<TreeSource> treeSource;
+    if(tree != nullptr && source != nullptr) {
+        treeSource = std::make_shared<TreeSource>();
+        treeSource->text.assign(reinterpret_cast<const char*>(data), length * sizeof(jchar));
+        treeSource->encoding = TSInputEncodingUTF16;
+    }
+    
+    if(critical) env->ReleaseStringCritical(text, data);
+    if(treeSource != nullptr) storeTreeSource(env, source, 0, std::move(treeSource));
+    
+    return reinterpret_cast<jlong>(tree);
+}
+
+/**
+ * Use the parser to parse the source code stored in a direct `ByteBuffer`.
+ *
+ * The buffer memory lives outside of the java heap, so its address is handed
+ * to `ts_parser_parse_string_encoding` as is, without any copy.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_parseDirectBuffer(JNIEnv* env, jobject thiz,
+                                                              jlong parser, jlong oldTree, jobject buffer,
+                                                              jint offset, jint length, jobject charset) {
+    if(!checkParserArena(env, reinterpret_cast<TSParser*>(parser))) return 0;
+
+    // get the text encoding
+    TSInputEncoding encoding = nativeEncoding(env, charset);
+
+    const char *source = static_cast<const char*>(env->GetDirectBufferAddress(buffer));
+    if(source == nullptr) {
+        LOGE("Error: %s\n", "The buffer is not a direct buffer");
+        return 0;
+    }
+
+    ParseScope scope(reinterpret_cast<TSParser*>(parser));
+    TSTree *tree = scope.finish(ts_parser_parse_string_encoding(
+        reinterpret_cast<TSParser*>(parser),
+        reinterpret_cast<TSTree*>(oldTree),
+        source + offset,
+        length,
+        encoding
+    ));
+
+    return reinterpret_cast<jlong>(tree);
+}
+
+// parse a region of the byte array, pinned without a copy when the 
+// parser has no logger calling back into java
+static TSTree *parsePinnedBytes(JNIEnv *env, TSParser *parser, TSTree *oldTree, jbyteArray bytes,
+                                const jint offset, const jint length, const TSInputEncoding encoding) {
+    bool critical = ts_parser_logger(parser).log == nullptr;
+
+    jbyte *source = critical ?
+        static_cast<jbyte*>(env->GetPrimitiveArrayCritical(bytes, nullptr)) :
+        env->GetByteArrayElements(bytes, nullptr);
+
+    ParseScope scope(parser);
+    TSTree *tree = scope.finish(ts_parser_parse_string_encoding(
+        parser,
+        oldTree,
+        reinterpret_cast<const char*>(source + offset),
+        length,
+        encoding
+    ));
+
+    if(critical)
+        env->ReleasePrimitiveArrayCritical(bytes, source, JNI_ABORT);
+    else
+        env->ReleaseByteArrayElements(bytes, source, JNI_ABORT);
+
+    return tree;
+}
+
+/**
+ * Use the parser to parse a region of a byte array.
+ *
+ * The array is pinned with `GetPrimitiveArrayCritical`, which hands out the
+ * heap memory itself instead of the malloc + memcpy that `GetByteArrayElements`
+ * does for arrays living in a movable space. No JNI function may be called
+ * while the array is pinned, so a parser with a logger falls back to
+ * `GetByteArrayElements`, the logger calls back into java.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_parseBytes(JNIEnv* env, jobject thiz,
+                                                       jlong parser, jlong oldTree, jbyteArray bytes,
+                                                       jint offset, jint length, jobject charset) {
+    if(!checkParserArena(env, reinterpret_cast<TSParser*>(parser))) return 0;
+
+    // get the text encoding
+    TSInputEncoding encoding = nativeEncoding(env, charset);
+
+    return reinterpret_cast<jlong>(parsePinnedBytes(
+        env,
+        reinterpret_cast<TSParser*>(parser),
+        reinterpret_cast<TSTree*>(oldTree),
+        bytes,
+        offset,
+        length,
+        encoding
+    ));
+}
+
+/**
+ * Apply a batch of edits to a copy of the tree, parse the edited source and
+ * compare the trees, with a single JNI call.
+ *
+ * Every edit is 9 ints: start byte, old end byte, new end byte, start row,
+ * start column, old end row, old end column, new end row and new end column.
+ * The new tree is written to `newTree[0]`, the old tree is not modified so
+ * it can still be read by other threads. If `retainSource` is set the new
+ * tree keeps a copy of the bytes and its handle is written to `newTree[1]`. Returns the changed ranges as 6 ints
+ * each: start byte, end byte, start row, start column, end row and end column.
+ * If the parse fails `newTree[0]` is 0.
+ */
+JNIEXPORT jintArray JNICALL
+Java_io_github_module_treesitter_TreeSitter_reparse(JNIEnv* env, jobject thiz,
+                                                    jlong parser, jlong oldTree, jintArray edits,
+                                                    jbyteArray bytes, jobject charset, jlongArray newTree,
+                                                    jboolean retainSource) {
+    if(!checkParserArena(env, reinterpret_cast<TSParser*>(parser))) return nullptr;
+
+    TSInputEncoding encoding = nativeEncoding(env, charset);
+    KindScope scope(MEMORY_KIND_TREE);
+    TSTree *tree = ts_tree_copy(reinterpret_cast<TSTree*>(oldTree));
+    
+    jsize editCount = env->GetArrayLength(edits) / 9;
+    jint *values = env->GetIntArrayElements(edits, nullptr);
+    for(jsize i=0; i < editCount; ++i) {
+        const jint *edit = values + i * 9;
+        TSInputEdit inputEdit {
+            static_cast<uint32_t>(edit[0]),
+            static_cast<uint32_t>(edit[1]),
+            static_cast<uint32_t>(edit[2]),
+            {static_cast<uint32_t>(edit[3]), static_cast<uint32_t>(edit[4])},
+            {static_cast<uint32_t>(edit[5]), static_cast<uint32_t>(edit[6])},
+            {static_cast<uint32_t>(edit[7]), static_cast<uint32_t>(edit[8])}
+        };
+        ts_tree_edit(tree, &inputEdit);
+    }
+    env->ReleaseIntArrayElements(edits, values, JNI_ABORT);
+    
+    TSTree *result = parsePinnedBytes(
+        env,
+        reinterpret_cast<TSParser*>(parser),
+        tree,
+        bytes,
+        0,
+        env->GetArrayLength(bytes),
+        encoding
     );
     
-    env->ReleaseByteArrayElements(bytes, source, JNI_ABORT);
-    env->DeleteLocalRef(javaTSInputEncoding);
+    jlong resultPointer = reinterpret_cast<jlong>(result);
+    env->SetLongArrayRegion(newTree, 0, 1, &resultPointer);
+    if(result == nullptr) {
+        ts_tree_delete(tree);
+        return env->NewIntArray(0);
+    }
+    
+    // the new tree retains the new source, its handle is written to newTree[1]
+    if(retainSource) {
+        std::shared_ptr<TreeSource> treeSource = std::make_shared<TreeSource>();
+        treeSource->text.resize(env->GetArrayLength(bytes));
+        env->GetByteArrayRegion(bytes, 0, treeSource->text.size(), reinterpret_cast<jbyte*>(&treeSource->text[0]));
+        treeSource->encoding = encoding;
+        storeTreeSource(env, newTree, 1, std::move(treeSource));
+    }
+    
+    uint32_t length;
+    TSRange *ranges = ts_tree_get_changed_ranges(tree, result, &length);
+    ts_tree_delete(tree);
+    
+    std::vector<jint> packed;
+    packed.reserve(length * 6);
+    for(uint32_t i=0; i < length; ++i) {
+        packed.push_back(ranges[i].start_byte);
+        packed.push_back(ranges[i].end_byte);
+        packed.push_back(ranges[i].start_point.row);
+        packed.push_back(ranges[i].start_point.column);
+        packed.push_back(ranges[i].end_point.row);
+        packed.push_back(ranges[i].end_point.column);
+    }
+    allocatorFree(ranges);
+    
+    jintArray rangeArray = env->NewIntArray(packed.size());
+    env->SetIntArrayRegion(rangeArray, 0, packed.size(), packed.data());
+    return rangeArray;
+}
+
+// parse the file mapped into memory, returns null and sets the error 
+// number when the file cannot be read, the mapping is kept alive by
+// the retained source if requested
+static TSTree *parseMappedFile(TSParser *parser, const char *path, const TSInputEncoding encoding, 
+                               std::shared_ptr<TreeSource> *retained, int *error) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) < 0) {
+        *error = errno;
+        if(fd >= 0) close(fd);
+        return nullptr;
+    }
+
+    size_t length = static_cast<size_t>(st.st_size);
+    void *source = nullptr;
+    // mmap does not accept a zero length, parse the empty file as an empty string
+    if(length > 0) {
+        source = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(source == MAP_FAILED) {
+            *error = errno;
+            close(fd);
+            return nullptr;
+        }
+        // the parser reads the text front to back
+        madvise(source, length, MADV_SEQUENTIAL);
+    }
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+
+    ParseScope scope(parser);
+    TSTree *tree = scope.finish(ts_parser_parse_string_encoding(
+        parser,
+        nullptr,
+        length > 0 ? reinterpret_cast<const char*>(source) : "",
+        length,
+        encoding
+    ));
+
+    if(tree != nullptr && retained != nullptr) {
+        *retained = std::make_shared<TreeSource>();
+        (*retained)->mapping = source;
+        (*retained)->mappingLength = length;
+        (*retained)->encoding = encoding;
+    } else if(source != nullptr) {
+        munmap(source, length);
+    }
     
+    *error = 0;
+    return tree;
+}
+
+/**
+ * Use the parser to parse the source code stored in the given file.
+ *
+ * The file is mapped into memory with `mmap` and handed to
+ * `ts_parser_parse_string_encoding` directly, so the text is read from the
+ * page cache without being copied into the java heap. If `source` is given
+ * the tree keeps the mapping, its handle is written to `source[0]` and the
+ * node texts are read from it.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_parseFile(JNIEnv* env, jobject thiz, jlong parser, 
+                                                      jstring pathname, jobject charset, jlongArray source) {
+    if(!checkParserArena(env, reinterpret_cast<TSParser*>(parser))) return 0;
+
+    // get the text encoding
+    TSInputEncoding encoding = nativeEncoding(env, charset);
+
+    const char *path = env->GetStringUTFChars(pathname, nullptr);
+    int error = 0;
+    std::shared_ptr<TreeSource> treeSource;
+    TSTree *tree = parseMappedFile(
+        reinterpret_cast<TSParser*>(parser), 
+        path, 
+        encoding, 
+        source != nullptr ? &treeSource : nullptr, 
+        &error
+    );
+    env->ReleaseStringUTFChars(pathname, path);
+    if(treeSource != nullptr) storeTreeSource(env, source, 0, std::move(treeSource));
+    
+    if(error != 0)
+        env->ThrowNew(javaIOExceptionClass, strerror(error));
+
     return reinterpret_cast<jlong>(tree);
 }
 
+/**
+ * Parse many files in parallel, every worker thread owns its own parser and
+ * takes the next unparsed file until all of the files are parsed, so a few
+ * large files do not hold back the others. The worker threads never call
+ * into the jvm.
+ *
+ * Returns the trees in the order of the paths, the parse time in nanoseconds
+ * and the error number of each file are written to the given arrays. A file
+ * that cannot be read has a null tree and a non-zero error number. Throws an
+ * IllegalArgumentException if the language can not be used by a parser.
+ */
+JNIEXPORT jlongArray JNICALL
+Java_io_github_module_treesitter_TreeSitter_parseFiles(JNIEnv* env, jobject thiz,
+                                                       jobjectArray pathnames, jlong language, 
+                                                       jint threadCount, jobject charset,
+                                                       jlongArray timings, jintArray errors) {
+    // the check of ts_parser_set_language, once for all of the workers
+    const TSLanguage *nativeLanguage = reinterpret_cast<const TSLanguage*>(language);
+    uint32_t version = nativeLanguage != nullptr ? ts_language_version(nativeLanguage) : 0;
+    if(version < TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION || version > TREE_SITTER_LANGUAGE_VERSION) {
+        env->ThrowNew(javaIllegalArgumentExceptionClass, "the language version is incompatible");
+        return nullptr;
+    }
+    
+    TSInputEncoding encoding = nativeEncoding(env, charset);
+    const jsize count = env->GetArrayLength(pathnames);
+    
+    // copy the paths before the workers start
+    std::vector<std::string> paths(count);
+    for(jsize i=0; i < count; ++i) {
+        jstring pathname = static_cast<jstring>(env->GetObjectArrayElement(pathnames, i));
+        const char *path = env->GetStringUTFChars(pathname, nullptr);
+        paths[i] = path;
+        env->ReleaseStringUTFChars(pathname, path);
+        env->DeleteLocalRef(pathname);
+    }
+    
+    std::vector<jlong> trees(count, 0);
+    std::vector<jlong> times(count, 0);
+    std::vector<jint> errorNumbers(count, 0);
+    std::atomic<jsize> next(0);
+    
+    auto worker = [&]() {
+        KindScope scope(MEMORY_KIND_PARSER);
+        TSParser *parser = ts_parser_new();
+        ts_parser_set_language(parser, nativeLanguage);
+        
+        for(jsize i = next++; i < count; i = next++) {
+            auto start = std::chrono::steady_clock::now();
+            int error = 0;
+            TSTree *tree = parseMappedFile(parser, paths[i].c_str(), encoding, nullptr, &error);
+            if(tree == nullptr && error == 0) {
+                // the parser failed without an io error
+                error = -1;
+                ts_parser_reset(parser);
+            }
+            times[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start
+            ).count();
+            trees[i] = reinterpret_cast<jlong>(tree);
+            errorNumbers[i] = error;
+        }
+        
+        ts_parser_delete(parser);
+    };
+    
+    jsize workerCount = std::max<jsize>(1, std::min<jsize>(threadCount, count));
+    std::vector<std::thread> workers;
+    // the calling thread is the last worker
+    for(jsize i=1; i < workerCount; ++i) {
+        try {
+            workers.emplace_back(worker);
+        } catch(const std::system_error &error) {
+            // the started workers and the calling thread take the remaining work
+            LOGE("Error: failed to start a worker thread, %s\n", error.what());
+            break;
+        }
+    }
+    worker();
+    for(std::thread &thread : workers)
+        thread.join();
+    
+    env->SetLongArrayRegion(timings, 0, count, times.data());
+    env->SetIntArrayRegion(errors, 0, count, errorNumbers.data());
+    
+    jlongArray treeArray = env->NewLongArray(count);
+    env->SetLongArrayRegion(treeArray, 0, count, trees.data());
+    return treeArray;
+}
+
 /**
  * Set the file descriptor to which the parser should write debugging graphs
  * during parsing. The graphs are formatted in the DOT language. You may want
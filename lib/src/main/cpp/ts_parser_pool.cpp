@@ -0,0 +1,179 @@
+/*
+ * Copyright © 2023 Github Lzhiyong
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include <tree_sitter/api.h>
+
+#include "jni_helper.h"
+#include "ts_allocator.h"
+#include "ts_utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// declare external functions
+extern void releaseParserLogger(JNIEnv*, TSParser*);
+extern void deleteParserState(JNIEnv*, TSParser*);
+
+// the idle parsers of each language, the lock is only held 
+// while a parser is taken from or put back to the free list
+struct TSParserPool {
+    std::mutex mutex;
+    std::unordered_map<const TSLanguage*, std::vector<TSParser*>> idle;
+    // the maximum idle parsers kept per language
+    uint32_t capacity;
+    uint32_t idleCount;
+    uint32_t activeCount;
+    uint64_t createdCount;
+    uint64_t reusedCount;
+};
+
+// clear everything a previous user may have set on the parser,
+// the internal stacks and allocations of the parser are kept
+static void resetPooledParser(JNIEnv *env, TSParser *parser) {
+    releaseParserLogger(env, parser);
+    ts_parser_set_timeout_micros(parser, 0);
+    ts_parser_set_cancellation_flag(parser, nullptr);
+    ts_parser_set_included_ranges(parser, nullptr, 0);
+    ts_parser_reset(parser);
+}
+
+/**
+ * Create a new parser pool keeping at most `capacity` idle parsers for each
+ * language.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_newParserPool(JNIEnv* env, jobject thiz, jint capacity) {
+    TSParserPool *pool = new TSParserPool();
+    pool->capacity = capacity;
+    pool->idleCount = 0;
+    pool->activeCount = 0;
+    pool->createdCount = 0;
+    pool->reusedCount = 0;
+    return reinterpret_cast<jlong>(pool);
+}
+
+/**
+ * Delete the parser pool and all of its idle parsers, the acquired parsers
+ * must be released before.
+ */
+JNIEXPORT void JNICALL
+Java_io_github_module_treesitter_TreeSitter_deleteParserPool(JNIEnv* env, jobject thiz, jlong pool) {
+    TSParserPool *parserPool = reinterpret_cast<TSParserPool*>(pool);
+    for(auto &entry : parserPool->idle) {
+        for(TSParser *parser : entry.second)
+            deleteParserState(env, parser);
+    }
+    delete parserPool;
+}
+
+/**
+ * Take an idle parser of the given language from the pool, or create a new
+ * one if there is none. Throws an IllegalArgumentException if the language
+ * version is incompatible.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_parserPoolAcquire(JNIEnv* env, jobject thiz, 
+                                                              jlong pool, jlong language) {
+    TSParserPool *parserPool = reinterpret_cast<TSParserPool*>(pool);
+    const TSLanguage *nativeLanguage = reinterpret_cast<const TSLanguage*>(language);
+    TSParser *parser = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(parserPool->mutex);
+        parserPool->activeCount++;
+        auto entry = parserPool->idle.find(nativeLanguage);
+        if(entry != parserPool->idle.end() && !entry->second.empty()) {
+            parser = entry->second.back();
+            entry->second.pop_back();
+            parserPool->idleCount--;
+            parserPool->reusedCount++;
+        } else {
+            parserPool->createdCount++;
+        }
+    }
+    
+    if(parser == nullptr) {
+        KindScope scope(MEMORY_KIND_PARSER);
+        parser = ts_parser_new();
+        // a parser without a language can not parse anything
+        if(!ts_parser_set_language(parser, nativeLanguage)) {
+            ts_parser_delete(parser);
+            {
+                std::lock_guard<std::mutex> lock(parserPool->mutex);
+                parserPool->activeCount--;
+                parserPool->createdCount--;
+            }
+            env->ThrowNew(javaIllegalArgumentExceptionClass, "the language version is incompatible");
+            return 0;
+        }
+    }
+    
+    return reinterpret_cast<jlong>(parser);
+}
+
+/**
+ * Put the parser back to the pool, the parser is deleted if the pool is full,
+ * the parser has no language or the parser was allocated from an arena.
+ */
+JNIEXPORT void JNICALL
+Java_io_github_module_treesitter_TreeSitter_parserPoolRelease(JNIEnv* env, jobject thiz, 
+                                                              jlong pool, jlong parser) {
+    TSParserPool *parserPool = reinterpret_cast<TSParserPool*>(pool);
+    TSParser *nativeParser = reinterpret_cast<TSParser*>(parser);
+    resetPooledParser(env, nativeParser);
+    const TSLanguage *language = ts_parser_language(nativeParser);
+    {
+        std::lock_guard<std::mutex> lock(parserPool->mutex);
+        parserPool->activeCount--;
+        if(language != nullptr && !isArenaBlock(nativeParser) 
+           && parserPool->idle[language].size() < parserPool->capacity) {
+            parserPool->idle[language].push_back(nativeParser);
+            parserPool->idleCount++;
+            nativeParser = nullptr;
+        }
+    }
+    
+    if(nativeParser != nullptr)
+        deleteParserState(env, nativeParser);
+}
+
+/**
+ * Get the occupancy of the pool: idle parsers, acquired parsers, parsers
+ * created and acquisitions served by an idle parser.
+ */
+JNIEXPORT jlongArray JNICALL
+Java_io_github_module_treesitter_TreeSitter_parserPoolStats(JNIEnv* env, jobject thiz, jlong pool) {
+    TSParserPool *parserPool = reinterpret_cast<TSParserPool*>(pool);
+    jlong stats[4];
+    {
+        std::lock_guard<std::mutex> lock(parserPool->mutex);
+        stats[0] = parserPool->idleCount;
+        stats[1] = parserPool->activeCount;
+        stats[2] = parserPool->createdCount;
+        stats[3] = parserPool->reusedCount;
+    }
+    
+    jlongArray statsArray = env->NewLongArray(4);
+    env->SetLongArrayRegion(statsArray, 0, 4, stats);
+    return statsArray;
+}
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
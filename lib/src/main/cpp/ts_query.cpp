@@ -15,9 +15,13 @@
  */
 
 #include <string.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include <tree_sitter/api.h>
 
 #include "jni_helper.h"
+#include "ts_allocator.h"
 #include "ts_utils.h"
 
 #ifdef __cplusplus
@@ -29,6 +33,55 @@ jclass javaTSQuantifierClass = nullptr;
 jclass javaTSQueryPredicateStepClass = nullptr;
 jclass javaTSQueryPredicateStepTypeClass = nullptr;
 
+// declare external functions
+struct QueryPredicates;
+extern QueryPredicates *compilePredicates(const TSQuery*, std::string*);
+extern void deletePredicates(QueryPredicates*);
+
+// a compiled query shared by every TSQuery with the same language and source,
+// the text predicates are compiled on the first use and shared as well
+struct SharedQuery {
+    TSQuery *query;
+    uint32_t references;
+    QueryPredicates *predicates;
+};
+
+// the shared queries keyed by the language pointer and the query source,
+// an unreferenced query stays cached until the cache is trimmed
+static std::mutex queryCacheMutex;
+static std::unordered_map<std::string, SharedQuery> queryCache;
+static std::unordered_map<const TSQuery*, std::string> queryKeys;
+
+// compile the query and report the error to the kotlin lambda
+static TSQuery *compileQuery(JNIEnv *env, const TSLanguage *language, 
+                             const char *source, const uint32_t length, jobject lambda) {
+    uint32_t error_offset;
+    TSQueryError error_type;
+    
+    KindScope scope(MEMORY_KIND_QUERY);
+    TSQuery *query = ts_query_new(
+        language,
+        source,
+        length,
+        &error_offset,
+        &error_type
+    );
+    
+    if(lambda != nullptr) {
+        // callback
+        jmethodID invoke = getMethod(env, lambda, "(ILio/github/module/treesitter/TSQueryError;)V");
+        
+        if(error_type > TSQueryErrorLanguage) {
+            LOGE("Error: Unknown field %d of TSQueryError class\n", error_type);
+        } else {
+            // call onError
+            env->CallVoidMethod(lambda, invoke, error_offset, javaTSQueryErrors[error_type]);
+        }
+    }
+    
+    return query;
+}
+
 /**
  * Create a new query from a string containing one or more S-expression
  * patterns. The query is associated with a particular language, and can
@@ -43,69 +96,145 @@ jclass javaTSQueryPredicateStepTypeClass = nullptr;
 JNIEXPORT jlong JNICALL
 Java_io_github_module_treesitter_TreeSitter_newQuery(JNIEnv* env, jobject thiz, 
                                                      jlong language, jstring expression, jobject lambda) {
-    uint32_t error_offset;
-    TSQueryError error_type;
+    const char *source = env->GetStringUTFChars(expression, nullptr);
+    TSQuery *query = compileQuery(
+        env, 
+        reinterpret_cast<TSLanguage*>(language), 
+        source, 
+        strlen(source), 
+        lambda
+    );
+    env->ReleaseStringUTFChars(expression, source);
     
+    return reinterpret_cast<jlong>(query);
+}
+
+/**
+ * Get the query compiled from the same language and source from the cache,
+ * or compile it and add it to the cache. The query is reference counted and
+ * must be released with `releaseSharedQuery`, the queries that failed to
+ * compile are not cached. The lambda is only called when the query is
+ * compiled.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_newSharedQuery(JNIEnv* env, jobject thiz, 
+                                                           jlong language, jstring expression, jobject lambda) {
     const char *source = env->GetStringUTFChars(expression, nullptr);
-    const TSQuery *query = ts_query_new(
-        reinterpret_cast<TSLanguage*>(language),
-        source,
-        strlen(source),
-        &error_offset,
-        &error_type
+    std::string key = std::to_string(language) + ":" + source;
+    
+    {
+        std::lock_guard<std::mutex> lock(queryCacheMutex);
+        auto entry = queryCache.find(key);
+        if(entry != queryCache.end()) {
+            entry->second.references++;
+            env->ReleaseStringUTFChars(expression, source);
+            return reinterpret_cast<jlong>(entry->second.query);
+        }
+    }
+    
+    // compile without the lock, the lambda calls back into java
+    TSQuery *query = compileQuery(
+        env, 
+        reinterpret_cast<TSLanguage*>(language), 
+        source, 
+        strlen(source), 
+        lambda
     );
+    env->ReleaseStringUTFChars(expression, source);
+    if(query == nullptr)
+        return 0;
     
-    if(lambda != nullptr) {
-        jclass javaTSQueryErrorClass = env->FindClass("io/github/module/treesitter/TSQueryError");
-        // callback
-        jmethodID invoke = getMethod(env, lambda, "(ILio/github/module/treesitter/TSQueryError;)V");
+    std::lock_guard<std::mutex> lock(queryCacheMutex);
+    auto result = queryCache.emplace(key, SharedQuery {query, 1, nullptr});
+    if(!result.second) {
+        // another thread compiled the same query first
+        ts_query_delete(query);
+        result.first->second.references++;
+    } else {
+        queryKeys.emplace(query, key);
+    }
     
-        jfieldID field = nullptr;
+    return reinterpret_cast<jlong>(result.first->second.query);
+}
+
+/**
+ * Release a reference of the shared query, the query stays in the cache.
+ */
+JNIEXPORT void JNICALL
+Java_io_github_module_treesitter_TreeSitter_releaseSharedQuery(JNIEnv* env, jobject thiz, jlong query) {
+    std::lock_guard<std::mutex> lock(queryCacheMutex);
+    auto key = queryKeys.find(reinterpret_cast<TSQuery*>(query));
+    if(key == queryKeys.end()) {
+        LOGE("Error: the query is not a shared query\n");
+        return;
+    }
     
-        switch(error_type) {
-            case TSQueryErrorNone:
-                field = env->GetStaticFieldID(javaTSQueryErrorClass, "NONE", "Lio/github/module/treesitter/TSQueryError;");
-                break;
-            case TSQueryErrorSyntax:
-                field = env->GetStaticFieldID(javaTSQueryErrorClass, "SYNTAX", "Lio/github/module/treesitter/TSQueryError;");
-                break;
-            case TSQueryErrorNodeType:
-                field = env->GetStaticFieldID(javaTSQueryErrorClass, "NODE_TYPE", "Lio/github/module/treesitter/TSQueryError;");
-                break;
-            case TSQueryErrorField:
-                field = env->GetStaticFieldID(javaTSQueryErrorClass, "FIELD", "Lio/github/module/treesitter/TSQueryError;");
-                break;
-            case TSQueryErrorCapture:
-                field = env->GetStaticFieldID(javaTSQueryErrorClass, "CAPTURE", "Lio/github/module/treesitter/TSQueryError;");
-                break;
-            case TSQueryErrorStructure:
-                field = env->GetStaticFieldID(javaTSQueryErrorClass, "STRUCTURE", "Lio/github/module/treesitter/TSQueryError;");
-                break;
-            case TSQueryErrorLanguage:
-                field = env->GetStaticFieldID(javaTSQueryErrorClass, "LANGUAGE", "Lio/github/module/treesitter/TSQueryError;");
-                break;
-            default:
-                LOGE("Error: Unknown field %d of TSQueryError class\n", error_type);
-                break;
+    auto entry = queryCache.find(key->second);
+    if(entry != queryCache.end() && entry->second.references > 0)
+        entry->second.references--;
+}
+
+/**
+ * Get the text predicates of the shared query, they are compiled once and 
+ * live as long as the query stays in the cache, see `newQueryPredicates`.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_sharedQueryPredicates(JNIEnv* env, jobject thiz, jlong query) {
+    {
+        std::lock_guard<std::mutex> lock(queryCacheMutex);
+        auto key = queryKeys.find(reinterpret_cast<TSQuery*>(query));
+        if(key == queryKeys.end()) {
+            LOGE("Error: the query is not a shared query\n");
+            return 0;
         }
+        
+        QueryPredicates *predicates = queryCache.find(key->second)->second.predicates;
+        if(predicates != nullptr)
+            return reinterpret_cast<jlong>(predicates);
+    }
     
-        jobject typeObject = env->GetStaticObjectField(javaTSQueryErrorClass, field);
-        // call onError
-        env->CallVoidMethod(lambda, invoke, error_offset, typeObject);
-        env->DeleteLocalRef(javaTSQueryErrorClass);
+    // compile the regexes without the lock, the query is kept 
+    // in the cache by the reference of the caller
+    std::string error;
+    QueryPredicates *predicates = compilePredicates(reinterpret_cast<TSQuery*>(query), &error);
+    if(predicates == nullptr) {
+        env->ThrowNew(javaIllegalArgumentExceptionClass, error.c_str());
+        return 0;
     }
     
-    env->ReleaseStringUTFChars(expression, source);
+    std::lock_guard<std::mutex> lock(queryCacheMutex);
+    SharedQuery &shared = queryCache.find(queryKeys.find(reinterpret_cast<TSQuery*>(query))->second)->second;
+    if(shared.predicates == nullptr) {
+        shared.predicates = predicates;
+    } else {
+        // another thread compiled the predicates first
+        deletePredicates(predicates);
+    }
     
-    return reinterpret_cast<jlong>(query);
+    return reinterpret_cast<jlong>(shared.predicates);
 }
 
 /**
- * Delete a query, freeing all of the memory that it used.
+ * Delete the cached queries that are not referenced, returns the number of
+ * the deleted queries.
  */
-JNIEXPORT void JNICALL
-Java_io_github_module_treesitter_TreeSitter_deleteQuery(JNIEnv* env, jobject thiz, jlong query) {
-    ts_query_delete(reinterpret_cast<TSQuery*>(query));
+JNIEXPORT jint JNICALL
+Java_io_github_module_treesitter_TreeSitter_trimQueryCache(JNIEnv* env, jobject thiz) {
+    std::lock_guard<std::mutex> lock(queryCacheMutex);
+    jint count = 0;
+    for(auto entry = queryCache.begin(); entry != queryCache.end();) {
+        if(entry->second.references == 0) {
+            queryKeys.erase(entry->second.query);
+            if(entry->second.predicates != nullptr)
+                deletePredicates(entry->second.predicates);
+            ts_query_delete(entry->second.query);
+            entry = queryCache.erase(entry);
+            count++;
+        } else {
+            ++entry;
+        }
+    }
+    return count;
 }
 
 /**
@@ -164,44 +293,21 @@ Java_io_github_module_treesitter_TreeSitter_queryPredicatesForPattern(JNIEnv* en
         &length
     );
     
-    jmethodID constructor = env->GetMethodID(
-        javaTSQueryPredicateStepClass, 
-        "<init>", 
-        "(Lio/github/module/treesitter/TSQueryPredicateStepType;I)V"
-    );
-    
     jobjectArray predicateArray = env->NewObjectArray(length, javaTSQueryPredicateStepClass, nullptr);
     
-    // java enum TSQueryPredicateStepType fields
-    jfieldID field = nullptr;
-    
     for(int i=0; i < length; ++i) {      
-        switch(predicates[i].type) {
-            case TSQueryPredicateStepTypeDone:
-                field = env->GetStaticFieldID(javaTSQueryPredicateStepTypeClass, "DOWN", "Lio/github/module/treesitter/TSQueryPredicateStepType;");
-                break;
-            case TSQueryPredicateStepTypeCapture:
-                field = env->GetStaticFieldID(javaTSQueryPredicateStepTypeClass, "CAPTURE", "Lio/github/module/treesitter/TSQueryPredicateStepType;");
-                break;
-            case TSQueryPredicateStepTypeString:
-                field = env->GetStaticFieldID(javaTSQueryPredicateStepTypeClass, "STRING", "Lio/github/module/treesitter/TSQueryPredicateStepType;");
-                break;
-            default:
-                LOGE("Error: Unknown field %d of TSQueryPredicateStepType class\n", predicates[i].type);
-                break;
-        }
-        
         // java enum TSQueryPredicateStepType object
-        jobject predicateStepType = env->GetStaticObjectField(javaTSQueryPredicateStepTypeClass, field);
+        jobject predicateStepType = javaTSQueryPredicateStepTypes[predicates[i].type];
         
         jobject predicateObject = env->NewObject(
             javaTSQueryPredicateStepClass,
-            constructor,
+            javaTSQueryPredicateStepConstructor,
             predicateStepType,
             predicates[i].value_id
         );
         
         env->SetObjectArrayElement(predicateArray, i, predicateObject);
+        env->DeleteLocalRef(predicateObject);
     }
     
     return predicateArray;
@@ -239,30 +345,12 @@ Java_io_github_module_treesitter_TreeSitter_queryCaptureQuantifierForId(JNIEnv*
         captureId
     );
     
-    jfieldID field = nullptr;
-    
-    switch(quantifier) {
-        case TSQuantifierZero:
-            field = env->GetStaticFieldID(javaTSQuantifierClass, "ZERO", "Lio/github/module/treesitter/TSQuantifier;");
-            break;
-        case TSQuantifierZeroOrOne:
-            field = env->GetStaticFieldID(javaTSQuantifierClass, "ZERO_OR_ONE", "Lio/github/module/treesitter/TSQuantifier;");
-            break;
-        case TSQuantifierZeroOrMore:
-            field = env->GetStaticFieldID(javaTSQuantifierClass, "ZERO_OR_MORE", "Lio/github/module/treesitter/TSQuantifier;");
-            break;
-        case TSQuantifierOne:
-            field = env->GetStaticFieldID(javaTSQuantifierClass, "ONE", "Lio/github/module/treesitter/TSQuantifier;");
-            break;
-        case TSQuantifierOneOrMore:
-            field = env->GetStaticFieldID(javaTSQuantifierClass, "ONE_OR_MORE", "Lio/github/module/treesitter/TSQuantifier;");
-            break;
-        default:
-            LOGE("Error: Unknown field %d of TSQuantifier class\n", quantifier);
-            break;
+    if(quantifier > TSQuantifierOneOrMore) {
+        LOGE("Error: Unknown field %d of TSQuantifier class\n", quantifier);
+        return nullptr;
     }
     
-    return env->GetStaticObjectField(javaTSQuantifierClass, field);
+    return env->NewLocalRef(javaTSQuantifiers[quantifier]);
 }
 
 JNIEXPORT jstring JNICALL
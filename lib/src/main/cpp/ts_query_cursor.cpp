@@ -14,8 +14,17 @@
  * limitations under the License.
  */
  
+#include <algorithm>
+#include <atomic>
+#include <regex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
 #include <tree_sitter/api.h>
 
+#include "jni_helper.h"
+#include "ts_allocator.h"
 #include "ts_utils.h"
 
 #ifdef __cplusplus
@@ -27,25 +36,232 @@ jclass javaTSCaptureClass = nullptr;
 jclass javaTSQueryCaptureClass = nullptr;
 jclass javaTSQueryMatchClass = nullptr;
 
+// the text predicates that are evaluated natively
+enum TextPredicateKind { TextPredicateEq, TextPredicateMatch, TextPredicateAnyOf };
+
+struct TextPredicate {
+    TextPredicateKind kind;
+    // false for the not- variants
+    bool positive;
+    // false for the any- variants, one node is enough to satisfy it
+    bool matchAll;
+    uint32_t capture;
+    // the second capture of `#eq? @a @b`, UINT32_MAX for a string
+    uint32_t otherCapture;
+    std::string value;
+    std::regex regex;
+    std::vector<std::string> values;
+};
+
+// the compiled text predicates, indexed by the pattern index
+struct QueryPredicates {
+    std::vector<std::vector<TextPredicate>> patterns;
+};
+
+// the source code the nodes are read from
+struct PredicateSource {
+    JNIEnv *env;
+    jbyteArray bytes;
+    jsize length;
+    TSInputEncoding encoding;
+    // the pinned bytes, read directly without JNI when not null
+    const jbyte *data = nullptr;
+    // scratch buffers, reused by every node
+    std::vector<jbyte> chunk;
+    std::string text;
+    std::string otherText;
+};
+
+static std::string stringValue(const TSQuery *query, const uint32_t id) {
+    uint32_t length;
+    const char *value = ts_query_string_value_for_id(query, id, &length);
+    return std::string(value, length);
+}
+
+// the text of a node is matched by `#match?` up to this many bytes, the regex
+// engine of libstdc++ recurses once per character and a long comment or 
+// string would overflow the stack
+#define MATCH_TEXT_LIMIT 1024
+
+// compile a single predicate, the unknown predicates such as `#set!` and 
+// `#is?` are not text predicates and are skipped. The regexes are ECMAScript
+// regexes of std::regex, not the Rust regexes of the tree-sitter CLI, so a 
+// few constructs differ. Returns false with the error for an invalid regex
+static bool compilePredicate(const TSQuery *query, const TSQueryPredicateStep *steps, 
+                             const uint32_t count, std::vector<TextPredicate> *output, 
+                             std::string *error) {
+    if(count < 3 || steps[0].type != TSQueryPredicateStepTypeString 
+       || steps[1].type != TSQueryPredicateStepTypeCapture)
+        return true;
+    
+    std::string name = stringValue(query, steps[0].value_id);
+    TextPredicate predicate;
+    predicate.capture = steps[1].value_id;
+    predicate.otherCapture = UINT32_MAX;
+    predicate.matchAll = true;
+    predicate.positive = true;
+    
+    if(name == "any-of?" || name == "not-any-of?") {
+        predicate.kind = TextPredicateAnyOf;
+        predicate.positive = name == "any-of?";
+        for(uint32_t i=2; i < count; ++i) {
+            if(steps[i].type != TSQueryPredicateStepTypeString) return true;
+            predicate.values.push_back(stringValue(query, steps[i].value_id));
+        }
+        output->push_back(std::move(predicate));
+        return true;
+    }
+    
+    if(name.compare(0, 4, "any-") == 0) {
+        predicate.matchAll = false;
+        name.erase(0, 4);
+    }
+    if(name.compare(0, 4, "not-") == 0) {
+        predicate.positive = false;
+        name.erase(0, 4);
+    }
+    if(count != 3) return true;
+    
+    if(name == "eq?") {
+        predicate.kind = TextPredicateEq;
+        if(steps[2].type == TSQueryPredicateStepTypeCapture)
+            predicate.otherCapture = steps[2].value_id;
+        else
+            predicate.value = stringValue(query, steps[2].value_id);
+    } else if(name == "match?" && steps[2].type == TSQueryPredicateStepTypeString) {
+        predicate.kind = TextPredicateMatch;
+        predicate.value = stringValue(query, steps[2].value_id);
+        try {
+            predicate.regex = std::regex(predicate.value, std::regex::ECMAScript | std::regex::optimize);
+        } catch(const std::regex_error &regexError) {
+            // a skipped predicate would let every match pass
+            *error = "invalid regex " + predicate.value + ", " + regexError.what();
+            return false;
+        }
+    } else {
+        return true;
+    }
+    
+    output->push_back(std::move(predicate));
+    return true;
+}
+
+// returns null with the error if a regex is invalid
+QueryPredicates *compilePredicates(const TSQuery *query, std::string *error) {
+    QueryPredicates *predicates = new QueryPredicates();
+    uint32_t patternCount = ts_query_pattern_count(query);
+    predicates->patterns.resize(patternCount);
+    
+    for(uint32_t pattern=0; pattern < patternCount; ++pattern) {
+        uint32_t length;
+        const TSQueryPredicateStep *steps = ts_query_predicates_for_pattern(query, pattern, &length);
+        
+        uint32_t start = 0;
+        for(uint32_t i=0; i < length; ++i) {
+            if(steps[i].type != TSQueryPredicateStepTypeDone) continue;
+            if(!compilePredicate(query, steps + start, i - start, &predicates->patterns[pattern], error)) {
+                delete predicates;
+                return nullptr;
+            }
+            start = i + 1;
+        }
+    }
+    
+    return predicates;
+}
+
+// read the text of the node as UTF-8 
+static void nodeText(PredicateSource *source, const TSNode node, std::string *text) {
+    jsize start = std::min<jsize>(ts_node_start_byte(node), source->length);
+    jsize end = std::min<jsize>(ts_node_end_byte(node), source->length);
+    text->clear();
+    if(end <= start) return;
+    
+    const jbyte *chars = source->data + start;
+    if(source->data == nullptr) {
+        source->chunk.resize(end - start);
+        source->env->GetByteArrayRegion(source->bytes, start, end - start, source->chunk.data());
+        chars = source->chunk.data();
+    }
+    
+    if(source->encoding == TSInputEncodingUTF16) {
+        utf16ToUtf8(reinterpret_cast<const jchar*>(chars), (end - start) / 2, text);
+    } else {
+        text->assign(reinterpret_cast<const char*>(chars), end - start);
+    }
+}
+
+static bool satisfiesText(PredicateSource *source, const TextPredicate &predicate, 
+                          const TSQueryMatch *match, const std::string &text) {
+    switch(predicate.kind) {
+    case TextPredicateEq:
+        if(predicate.otherCapture == UINT32_MAX) 
+            return text == predicate.value;
+        // compare with the first node of the other capture
+        for(uint16_t i=0; i < match->capture_count; ++i) {
+            if(match->captures[i].index != predicate.otherCapture) continue;
+            nodeText(source, match->captures[i].node, &source->otherText);
+            return text == source->otherText;
+        }
+        return false;
+    case TextPredicateMatch:
+        return std::regex_search(
+            text.begin(), 
+            text.begin() + std::min<size_t>(text.size(), MATCH_TEXT_LIMIT), 
+            predicate.regex
+        );
+    case TextPredicateAnyOf:
+        for(const std::string &value : predicate.values) {
+            if(text == value) return true;
+        }
+        return false;
+    }
+    return true;
+}
+
+// check the text predicates of the match pattern, the predicate is evaluated 
+// on every node of a quantified capture, and all (or any) of them must pass
+static bool satisfiesPredicates(PredicateSource *source, const QueryPredicates *predicates, 
+                                const TSQueryMatch *match) {
+    if(match->pattern_index >= predicates->patterns.size()) return true;
+    
+    for(const TextPredicate &predicate : predicates->patterns[match->pattern_index]) {
+        bool satisfied = predicate.matchAll;
+        for(uint16_t i=0; i < match->capture_count; ++i) {
+            if(match->captures[i].index != predicate.capture) continue;
+            
+            nodeText(source, match->captures[i].node, &source->text);
+            bool result = satisfiesText(source, predicate, match, source->text) == predicate.positive;
+            if(predicate.matchAll && !result) {
+                satisfied = false;
+                break;
+            }
+            if(!predicate.matchAll && result) {
+                satisfied = true;
+                break;
+            }
+        }
+        if(!satisfied) return false;
+    }
+    
+    return true;
+}
+
 // java TSQueryCapture array
 jobjectArray javaQueryCaptures(JNIEnv *env, const TSQueryCapture *captures, const uint32_t count) {
-    jmethodID constructor = env->GetMethodID(
-        javaTSQueryCaptureClass, 
-        "<init>", 
-        "(Lio/github/module/treesitter/TSNode;I)V"
-    );
-    
     jobjectArray captureArray = env->NewObjectArray(count, javaTSQueryCaptureClass, nullptr);
     
     for(int i=0; i < count; ++i) {
         jobject nodeObject = javaNode(env, &captures[i].node);
         jobject captureObject = env->NewObject(
             javaTSQueryCaptureClass, 
-            constructor,
+            javaTSQueryCaptureConstructor,
             nodeObject,
             captures[i].index
         );
         env->SetObjectArrayElement(captureArray, i, captureObject);
+        env->DeleteLocalRef(nodeObject);
+        env->DeleteLocalRef(captureObject);
     }
     
     return captureArray;
@@ -53,22 +269,19 @@ jobjectArray javaQueryCaptures(JNIEnv *env, const TSQueryCapture *captures, cons
 
 // java TSQueryMatch
 jobject javaQueryMatch(JNIEnv *env, const TSQueryMatch *match) {
-    jmethodID constructor = env->GetMethodID(
-        javaTSQueryMatchClass, 
-        "<init>", 
-        "(III[Lio/github/module/treesitter/TSQueryCapture;)V"
-    );
-    
     jobjectArray captureArray = javaQueryCaptures(env, match->captures, match->capture_count);
     
-    return env->NewObject(
+    jobject matchObject = env->NewObject(
         javaTSQueryMatchClass, 
-        constructor,
+        javaTSQueryMatchConstructor,
         match->id,
         match->pattern_index,
         match->capture_count,
         captureArray
     );
+    
+    env->DeleteLocalRef(captureArray);
+    return matchObject;
 }
 
 /**
@@ -95,6 +308,7 @@ jobject javaQueryMatch(JNIEnv *env, const TSQueryMatch *match) {
  */
 JNIEXPORT jlong JNICALL
 Java_io_github_module_treesitter_TreeSitter_newQueryCursor(JNIEnv* env, jobject thiz) {
+    KindScope scope(MEMORY_KIND_QUERY_CURSOR);
     return reinterpret_cast<jlong>(ts_query_cursor_new());
 }
 
@@ -207,16 +421,10 @@ Java_io_github_module_treesitter_TreeSitter_queryCusorNextCapture(JNIEnv* env, j
     if(ts_query_cursor_next_capture(reinterpret_cast<TSQueryCursor*>(cursor), &query_match, &capture_index)) {
         jobject match = javaQueryMatch(env, &query_match);
         
-        jmethodID constructor = env->GetMethodID(
-            javaTSCaptureClass, 
-            "<init>", 
-            "(Lio/github/module/treesitter/TSQueryMatch;I)V"
-        );
-        
         return env->NewObject(
             javaTSCaptureClass, 
-            constructor,
-            query_match,
+            javaTSCaptureConstructor,
+            match,
             capture_index
         );
     }
@@ -224,6 +432,343 @@ Java_io_github_module_treesitter_TreeSitter_queryCusorNextCapture(JNIEnv* env, j
     return nullptr;
 }
 
+// check the match against the compiled predicates, also used by the highlighter
+bool checkPredicates(JNIEnv *env, const jlong predicates, jbyteArray bytes, 
+                     const TSInputEncoding encoding, const TSQueryMatch *match) {
+    PredicateSource source;
+    source.env = env;
+    source.bytes = bytes;
+    source.length = env->GetArrayLength(bytes);
+    source.encoding = encoding;
+    return satisfiesPredicates(&source, reinterpret_cast<QueryPredicates*>(predicates), match);
+}
+
+// the captures as columns, see TSQueryCaptures
+struct CaptureColumns {
+    std::vector<jint> columns[CAPTURE_COLUMN_COUNT];
+    std::vector<jlong> ids;
+};
+
+// the start of the earliest captured node, the nodes captured later 
+// by an unfinished match start at or after it
+static uint32_t matchStartByte(const TSQueryMatch *match) {
+    uint32_t startByte = UINT32_MAX;
+    for(uint16_t i=0; i < match->capture_count; ++i)
+        startByte = std::min(startByte, ts_node_start_byte(match->captures[i].node));
+    return startByte;
+}
+
+// drain the cursor into the capture columns, the matches failing the predicates 
+// are removed when a source is given, only the matches whose earliest captured
+// node starts in the byte range [startByte, endByte) are kept
+static void drainCaptures(TSQueryCursor *queryCursor, const QueryPredicates *predicates, 
+                          PredicateSource *source, CaptureColumns *output,
+                          const uint32_t startByte = 0, const uint32_t endByte = UINT32_MAX) {
+    TSQueryMatch query_match;
+    uint32_t capture_index;
+    while(ts_query_cursor_next_capture(queryCursor, &query_match, &capture_index)) {
+        if(predicates != nullptr && !satisfiesPredicates(source, predicates, &query_match)) {
+            ts_query_cursor_remove_match(queryCursor, query_match.id);
+            continue;
+        }
+        
+        // a match is owned by one range with all of its captures, 
+        // even if they cross the end of the range
+        if(startByte > 0 || endByte < UINT32_MAX) {
+            uint32_t matchStart = matchStartByte(&query_match);
+            if(matchStart < startByte || matchStart >= endByte) 
+                continue;
+        }
+        
+        const TSQueryCapture &capture = query_match.captures[capture_index];
+        uint32_t nodeStartByte = ts_node_start_byte(capture.node);
+        TSPoint startPoint = ts_node_start_point(capture.node);
+        TSPoint endPoint = ts_node_end_point(capture.node);
+        
+        output->columns[0].push_back(capture.index);
+        output->columns[1].push_back(query_match.pattern_index);
+        output->columns[2].push_back(query_match.id);
+        output->columns[3].push_back(nodeStartByte);
+        output->columns[4].push_back(ts_node_end_byte(capture.node));
+        output->columns[5].push_back(startPoint.row);
+        output->columns[6].push_back(startPoint.column);
+        output->columns[7].push_back(endPoint.row);
+        output->columns[8].push_back(endPoint.column);
+        output->ids.push_back(reinterpret_cast<jlong>(capture.node.id));
+    }
+}
+
+// join the columns of the parts in order, the column k of
+// the capture i is at [k * count + i]
+static jobject javaCaptureColumns(JNIEnv *env, const CaptureColumns *parts, const size_t partCount) {
+    jint count = 0;
+    for(size_t i=0; i < partCount; ++i) 
+        count += parts[i].ids.size();
+    
+    std::vector<jint> data;
+    std::vector<jlong> ids;
+    data.reserve(count * CAPTURE_COLUMN_COUNT);
+    ids.reserve(count);
+    for(int k=0; k < CAPTURE_COLUMN_COUNT; ++k) {
+        for(size_t i=0; i < partCount; ++i) 
+            data.insert(data.end(), parts[i].columns[k].begin(), parts[i].columns[k].end());
+    }
+    for(size_t i=0; i < partCount; ++i)
+        ids.insert(ids.end(), parts[i].ids.begin(), parts[i].ids.end());
+    
+    return javaQueryCaptureColumns(env, count, data.data(), ids.data());
+}
+
+static jobject collectCaptures(JNIEnv *env, TSQueryCursor *queryCursor, 
+                               const QueryPredicates *predicates, PredicateSource *source) {
+    CaptureColumns captures;
+    drainCaptures(queryCursor, predicates, source, &captures);
+    return javaCaptureColumns(env, &captures, 1);
+}
+
+/**
+ * Drain the cursor with `ts_query_cursor_next_capture` and return all of
+ * the captures as packed columns with a single JNI call.
+ */
+JNIEXPORT jobject JNICALL
+Java_io_github_module_treesitter_TreeSitter_queryCursorCollectCaptures(JNIEnv* env, jobject thiz, jlong cursor) {
+    return collectCaptures(env, reinterpret_cast<TSQueryCursor*>(cursor), nullptr, nullptr);
+}
+
+/**
+ * Compile the text predicates `#eq?`, `#match?`, `#any-of?` and their
+ * `not-` and `any-` variants of every pattern in the query, the regexes are
+ * compiled once here. The other predicates are ignored. Throws an
+ * IllegalArgumentException if a regex is invalid.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_newQueryPredicates(JNIEnv* env, jobject thiz, jlong query) {
+    std::string error;
+    QueryPredicates *predicates = compilePredicates(reinterpret_cast<TSQuery*>(query), &error);
+    if(predicates == nullptr)
+        env->ThrowNew(javaIllegalArgumentExceptionClass, error.c_str());
+    return reinterpret_cast<jlong>(predicates);
+}
+
+void deletePredicates(QueryPredicates *predicates) {
+    delete predicates;
+}
+
+JNIEXPORT void JNICALL
+Java_io_github_module_treesitter_TreeSitter_deleteQueryPredicates(JNIEnv* env, jobject thiz, jlong predicates) {
+    deletePredicates(reinterpret_cast<QueryPredicates*>(predicates));
+}
+
+/**
+ * Advance to the next match that satisfies the text predicates, the node
+ * text is read from the given source. The other matches never cross JNI.
+ */
+JNIEXPORT jobject JNICALL
+Java_io_github_module_treesitter_TreeSitter_queryCursorNextFilteredMatch(JNIEnv* env, jobject thiz, 
+                                                                         jlong cursor, jlong predicates,
+                                                                         jbyteArray bytes, jobject charset) {
+    PredicateSource source;
+    source.env = env;
+    source.bytes = bytes;
+    source.length = env->GetArrayLength(bytes);
+    source.encoding = nativeEncoding(env, charset);
+    
+    TSQueryMatch query_match;
+    while(ts_query_cursor_next_match(reinterpret_cast<TSQueryCursor*>(cursor), &query_match)) {
+        if(satisfiesPredicates(&source, reinterpret_cast<QueryPredicates*>(predicates), &query_match))
+            return javaQueryMatch(env, &query_match);
+    }
+    
+    return nullptr;
+}
+
+/**
+ * Drain the cursor like `queryCursorCollectCaptures`, but only keep the
+ * captures of the matches that satisfy the text predicates.
+ */
+JNIEXPORT jobject JNICALL
+Java_io_github_module_treesitter_TreeSitter_queryCursorCollectFilteredCaptures(JNIEnv* env, jobject thiz, 
+                                                                               jlong cursor, jlong predicates,
+                                                                               jbyteArray bytes, jobject charset) {
+    PredicateSource source;
+    source.env = env;
+    source.bytes = bytes;
+    source.length = env->GetArrayLength(bytes);
+    source.encoding = nativeEncoding(env, charset);
+    
+    return collectCaptures(
+        env, 
+        reinterpret_cast<TSQueryCursor*>(cursor), 
+        reinterpret_cast<QueryPredicates*>(predicates), 
+        &source
+    );
+}
+
+/**
+ * Drain the cursor and return the ranges of the nodes captured with the given
+ * capture index, sorted and with the overlapping ranges merged, in the format
+ * of `setParserIncludedRanges`. The predicates are checked when a source is
+ * given. The injected language can then be parsed without copying any text.
+ */
+JNIEXPORT jintArray JNICALL
+Java_io_github_module_treesitter_TreeSitter_queryCursorCaptureRanges(JNIEnv* env, jobject thiz, 
+                                                                     jlong cursor, jint captureIndex,
+                                                                     jlong predicates, jbyteArray bytes, 
+                                                                     jobject charset) {
+    TSQueryCursor *queryCursor = reinterpret_cast<TSQueryCursor*>(cursor);
+    PredicateSource source;
+    if(bytes != nullptr) {
+        source.env = env;
+        source.bytes = bytes;
+        source.length = env->GetArrayLength(bytes);
+        source.encoding = nativeEncoding(env, charset);
+    }
+    
+    std::vector<TSRange> ranges;
+    TSQueryMatch query_match;
+    uint32_t capture_index;
+    while(ts_query_cursor_next_capture(queryCursor, &query_match, &capture_index)) {
+        const TSQueryCapture &capture = query_match.captures[capture_index];
+        if(capture.index != static_cast<uint32_t>(captureIndex)) continue;
+        if(bytes != nullptr && predicates != 0
+           && !satisfiesPredicates(&source, reinterpret_cast<QueryPredicates*>(predicates), &query_match)) {
+            ts_query_cursor_remove_match(queryCursor, query_match.id);
+            continue;
+        }
+        
+        ranges.push_back(TSRange {
+            ts_node_start_point(capture.node),
+            ts_node_end_point(capture.node),
+            ts_node_start_byte(capture.node),
+            ts_node_end_byte(capture.node)
+        });
+    }
+    
+    std::sort(ranges.begin(), ranges.end(), [](const TSRange &a, const TSRange &b) {
+        return a.start_byte < b.start_byte;
+    });
+    
+    std::vector<jint> packed;
+    packed.reserve(ranges.size() * 6);
+    for(const TSRange &range : ranges) {
+        size_t last = packed.size();
+        // merge with the previous range if they overlap
+        if(last > 0 && range.start_byte <= static_cast<uint32_t>(packed[last - 5])) {
+            if(range.end_byte > static_cast<uint32_t>(packed[last - 5])) {
+                packed[last - 5] = range.end_byte;
+                packed[last - 2] = range.end_point.row;
+                packed[last - 1] = range.end_point.column;
+            }
+            continue;
+        }
+        packed.push_back(range.start_byte);
+        packed.push_back(range.end_byte);
+        packed.push_back(range.start_point.row);
+        packed.push_back(range.start_point.column);
+        packed.push_back(range.end_point.row);
+        packed.push_back(range.end_point.column);
+    }
+    
+    jintArray rangeArray = env->NewIntArray(packed.size());
+    env->SetIntArrayRegion(rangeArray, 0, packed.size(), packed.data());
+    return rangeArray;
+}
+
+/**
+ * Run the query over the whole tree on several threads. The top-level
+ * children of the root node are split into contiguous byte ranges of about
+ * the same size, and every thread runs its own cursor with
+ * `ts_query_cursor_set_byte_range` on its own copy of the tree, taking the
+ * next range until all of the ranges are done.
+ *
+ * A match is kept by the range its earliest captured node starts in, with
+ * all of its captures, so a match crossing the end of a range, e.g. a comment
+ * anchored to the next function, is reported once and whole. The results are
+ * merged in range order in the format of `queryCursorCollectCaptures`. The predicates are
+ * checked when a source is given.
+ */
+JNIEXPORT jobject JNICALL
+Java_io_github_module_treesitter_TreeSitter_queryParallel(JNIEnv* env, jobject thiz, 
+                                                          jlong tree, jlong query, jint threadCount,
+                                                          jlong predicates, jbyteArray bytes, 
+                                                          jobject charset) {
+    TSTree *nativeTree = reinterpret_cast<TSTree*>(tree);
+    TSNode root = ts_tree_root_node(nativeTree);
+    
+    // split the top-level children into ranges, a few more than the 
+    // threads so an expensive range does not keep the others waiting
+    const uint32_t childCount = ts_node_child_count(root);
+    const uint32_t rootEnd = ts_node_end_byte(root);
+    const uint32_t rangeCount = std::max<uint32_t>(1, std::min<uint32_t>(childCount, threadCount * 4));
+    const uint32_t rangeSize = rootEnd / rangeCount + 1;
+    std::vector<uint32_t> bounds;
+    bounds.push_back(0);
+    for(uint32_t i=0; i < childCount; ++i) {
+        uint32_t start = ts_node_start_byte(ts_node_child(root, i));
+        if(start >= bounds.back() + rangeSize) 
+            bounds.push_back(start);
+    }
+    bounds.push_back(UINT32_MAX);
+    const size_t partCount = bounds.size() - 1;
+    
+    // pin the source once, the worker threads can not call JNI
+    TSInputEncoding encoding = TSInputEncodingUTF8;
+    jbyte *data = nullptr;
+    jsize length = 0;
+    if(bytes != nullptr) {
+        encoding = nativeEncoding(env, charset);
+        data = env->GetByteArrayElements(bytes, nullptr);
+        length = env->GetArrayLength(bytes);
+    }
+    const QueryPredicates *queryPredicates = bytes != nullptr && predicates != 0 ?
+        reinterpret_cast<QueryPredicates*>(predicates) : nullptr;
+    
+    std::vector<CaptureColumns> parts(partCount);
+    std::atomic<size_t> next(0);
+    
+    auto worker = [&]() {
+        // trees are not thread safe, every thread works on its own copy
+        KindScope scope(MEMORY_KIND_QUERY_CURSOR);
+        TSTree *copy = ts_tree_copy(nativeTree);
+        TSQueryCursor *queryCursor = ts_query_cursor_new();
+        PredicateSource source;
+        source.env = nullptr;
+        source.bytes = nullptr;
+        source.length = length;
+        source.encoding = encoding;
+        source.data = data;
+        
+        for(size_t i = next++; i < partCount; i = next++) {
+            ts_query_cursor_set_byte_range(queryCursor, bounds[i], bounds[i + 1]);
+            ts_query_cursor_exec(queryCursor, reinterpret_cast<TSQuery*>(query), ts_tree_root_node(copy));
+            drainCaptures(queryCursor, queryPredicates, &source, &parts[i], bounds[i], bounds[i + 1]);
+        }
+        
+        ts_query_cursor_delete(queryCursor);
+        ts_tree_delete(copy);
+    };
+    
+    size_t workerCount = std::max<size_t>(1, std::min<size_t>(threadCount, partCount));
+    std::vector<std::thread> workers;
+    // the calling thread is the last worker
+    for(size_t i=1; i < workerCount; ++i) {
+        try {
+            workers.emplace_back(worker);
+        } catch(const std::system_error &error) {
+            // the started workers and the calling thread take the remaining work
+            LOGE("Error: failed to start a worker thread, %s\n", error.what());
+            break;
+        }
+    }
+    worker();
+    for(std::thread &thread : workers)
+        thread.join();
+    
+    if(data != nullptr)
+        env->ReleaseByteArrayElements(bytes, data, JNI_ABORT);
+    
+    return javaCaptureColumns(env, parts.data(), partCount);
+}
 
 #ifdef __cplusplus
 }
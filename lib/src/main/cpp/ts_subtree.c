@@ -0,0 +1,70 @@
+/*
+ * Copyright © 2023 Github Lzhiyong
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+// the internal headers of tree-sitter are C, so the subtrees 
+// are only read by this translation unit
+#include "subtree.h"
+#include "tree.h"
+
+#include "ts_subtree.h"
+
+// the subtrees are walked with their own stack, a deep tree would
+// overflow the native stack, the stack is not counted memory
+void visitTreeBlocks(const TSTree *tree, const TreeBlockVisitor *visitor) {
+    visitor->visitBlock(visitor->payload, (void*)tree);
+    if(tree->included_ranges != NULL)
+        visitor->visitBlock(visitor->payload, tree->included_ranges);
+    if(tree->root.data.is_inline || tree->root.ptr == NULL) return;
+
+    size_t capacity = 64;
+    size_t size = 0;
+    const SubtreeHeapData **stack = malloc(capacity * sizeof(SubtreeHeapData*));
+    if(stack == NULL) return;
+    stack[size++] = tree->root.ptr;
+
+    while(size > 0) {
+        const SubtreeHeapData *data = stack[--size];
+        Subtree subtree = {.ptr = data};
+
+        // a node and its children are one block starting at the children,
+        // a leaf is its own block and may own a long external scanner state
+        if(data->child_count == 0) {
+            if(!visitor->enterSubtree(visitor->payload, (void*)data, data->ref_count)) continue;
+            if(data->has_external_tokens
+               && data->external_scanner_state.length > sizeof(data->external_scanner_state.short_data))
+                visitor->visitBlock(visitor->payload, data->external_scanner_state.long_data);
+            continue;
+        }
+
+        Subtree *children = ts_subtree_children(subtree);
+        if(!visitor->enterSubtree(visitor->payload, children, data->ref_count)) continue;
+        for(uint32_t i=0; i < data->child_count; ++i) {
+            Subtree child = children[i];
+            if(child.data.is_inline || child.ptr == NULL) continue;
+            if(size == capacity) {
+                const SubtreeHeapData **grown = realloc(stack, 2 * capacity * sizeof(SubtreeHeapData*));
+                if(grown == NULL) break;
+                stack = grown;
+                capacity *= 2;
+            }
+            stack[size++] = child.ptr;
+        }
+    }
+
+    free(stack);
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright © 2023 Github Lzhiyong
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TS_SUBTREE_H__
+#define __TS_SUBTREE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <tree_sitter/api.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the callbacks of visitTreeBlocks, every block is a pointer
+// returned by the allocator of tree-sitter
+typedef struct {
+    // the block of a heap subtree and its reference count, the
+    // descendants of the subtree are skipped if it returns false
+    bool (*enterSubtree)(void *payload, void *block, uint32_t references);
+    // the other blocks: the tree, its included ranges and the
+    // external scanner states of the entered subtrees
+    void (*visitBlock)(void *payload, void *block);
+    void *payload;
+} TreeBlockVisitor;
+
+// visit the blocks allocated for the tree, the subtrees with a single 
+// reference are only owned by their parent
+void visitTreeBlocks(const TSTree *tree, const TreeBlockVisitor *visitor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __TS_SUBTREE_H__
@@ -17,51 +17,99 @@
 
 #include <string.h>
 #include <errno.h>
+#include <algorithm>
+#include <vector>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <tree_sitter/api.h>
 
 #include "jni_helper.h"
+#include "ts_allocator.h"
+#include "ts_tree.h"
 #include "ts_utils.h"
 
+TreeSource::~TreeSource() {
+    if(mapping != nullptr) munmap(mapping, mappingLength);
+}
+
+void storeTreeSource(JNIEnv *env, jlongArray handles, const jsize index, std::shared_ptr<TreeSource> source) {
+    if(handles == nullptr) return;
+    jlong handle = reinterpret_cast<jlong>(new TreeSourceHandle(std::move(source)));
+    env->SetLongArrayRegion(handles, index, 1, &handle);
+}
+
+jstring javaSourceText(JNIEnv *env, const TreeSource *source, uint32_t start, uint32_t end, 
+                       std::vector<jchar> *scratch) {
+    end = std::min<size_t>(end, source->length());
+    start = std::min(start, end);
+    
+    if(source->encoding == TSInputEncodingUTF16) {
+        // the utf-16 source is little endian, the same as the jvm on our targets
+        return env->NewString(reinterpret_cast<const jchar*>(source->data() + start), (end - start) / 2);
+    }
+    
+    scratch->clear();
+    utf8ToUtf16(source->data() + start, end - start, scratch);
+    return env->NewString(scratch->data(), scratch->size());
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// columns of the flattened tree, each column holds one int per node
+#define FLAT_COLUMN_COUNT 9
+#define FLAT_FLAG_NAMED 0x01
+#define FLAT_FLAG_MISSING 0x02
+#define FLAT_FLAG_EXTRA 0x04
+#define FLAT_FLAG_HAS_ERROR 0x08
+
 // define global variables
 jclass javaTSRangeClass = nullptr;
 jclass javaTSInputEditClass = nullptr;
 
 // TSRange array
 jobjectArray getRanges(JNIEnv *env, const TSRange *ranges, const uint32_t length) {
-    jmethodID constructor = env->GetMethodID(
-        javaTSRangeClass, 
-        "<init>", 
-        "(Lio/github/module/treesitter/TSPoint;Lio/github/module/treesitter/TSPoint;II)V"
-    );
-    
     jobjectArray rangeArray = env->NewObjectArray(length, javaTSRangeClass, nullptr);
     
     for(int i=0; i < length; ++i) {
+        jobject startPoint = javaPoint(env, &ranges[i].start_point);
+        jobject endPoint = javaPoint(env, &ranges[i].end_point);
         jobject rangeObject = env->NewObject(
             javaTSRangeClass,
-            constructor,
-            javaPoint(env, &ranges[i].start_point),
-            javaPoint(env, &ranges[i].end_point),
+            javaTSRangeConstructor,
+            startPoint,
+            endPoint,
             ranges[i].start_byte,
             ranges[i].end_byte
         );
         
         env->SetObjectArrayElement(rangeArray, i, rangeObject);
+        env->DeleteLocalRef(startPoint);
+        env->DeleteLocalRef(endPoint);
+        env->DeleteLocalRef(rangeObject);
     }
     
     // free memory
-    free((void*)ranges);
+    allocatorFree((void*)ranges);
     
     return rangeArray;
 }
 
+/**
+ * Create a shallow copy of the syntax tree. This is very fast.
+ *
+ * You need to copy a syntax tree in order to use it on more than one thread at
+ * a time, as syntax trees are not thread safe.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_copyTree(JNIEnv* env, jobject thiz, jlong tree) {
+    KindScope scope(MEMORY_KIND_TREE);
+    return reinterpret_cast<jlong>(ts_tree_copy(reinterpret_cast<TSTree*>(tree)));
+}
+
 /**
  * Delete the syntax tree, freeing all of the memory that it used.
  */
@@ -70,6 +118,49 @@ Java_io_github_module_treesitter_TreeSitter_deleteTree(JNIEnv* env, jobject thiz
     ts_tree_delete(reinterpret_cast<TSTree*>(tree));
 }
 
+/**
+ * Get a new handle of the source retained by a tree, the handles share the
+ * source, it is freed with the last handle.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_shareTreeSource(JNIEnv* env, jobject thiz, jlong source) {
+    return reinterpret_cast<jlong>(new TreeSourceHandle(*reinterpret_cast<TreeSourceHandle*>(source)));
+}
+
+JNIEXPORT void JNICALL
+Java_io_github_module_treesitter_TreeSitter_deleteTreeSource(JNIEnv* env, jobject thiz, jlong source) {
+    delete reinterpret_cast<TreeSourceHandle*>(source);
+}
+
+/**
+ * Get the texts of many byte ranges of the retained source with a single
+ * call, the start and end bytes are read from the given offsets of the
+ * columns, see TSQueryCaptures.
+ */
+JNIEXPORT jobjectArray JNICALL
+Java_io_github_module_treesitter_TreeSitter_treeTexts(JNIEnv* env, jobject thiz, jlong source, jintArray columns,
+                                                      jint startOffset, jint endOffset, jint count) {
+    const TreeSource *treeText = treeSource(source);
+    if(treeText == nullptr) return nullptr;
+    
+    std::vector<jint> starts(count);
+    std::vector<jint> ends(count);
+    env->GetIntArrayRegion(columns, startOffset, count, starts.data());
+    env->GetIntArrayRegion(columns, endOffset, count, ends.data());
+    
+    jclass stringClass = env->FindClass("java/lang/String");
+    jobjectArray textArray = env->NewObjectArray(count, stringClass, nullptr);
+    env->DeleteLocalRef(stringClass);
+    
+    std::vector<jchar> scratch;
+    for(jint i=0; i < count; ++i) {
+        jstring text = javaSourceText(env, treeText, starts[i], ends[i], &scratch);
+        env->SetObjectArrayElement(textArray, i, text);
+        env->DeleteLocalRef(text);
+    }
+    return textArray;
+}
+
 /**
  * Get the root node of the syntax tree.
  */
@@ -97,23 +188,16 @@ Java_io_github_module_treesitter_TreeSitter_getTreeLanguage(JNIEnv* env, jobject
 JNIEXPORT void JNICALL
 Java_io_github_module_treesitter_TreeSitter_editTree(JNIEnv* env, jobject thiz, jlong tree, jobject inputEdit) {
     
-    jfieldID startByte = env->GetFieldID(javaTSInputEditClass, "startByte", "I");
-    jfieldID oldEndByte = env->GetFieldID(javaTSInputEditClass, "oldEndByte", "I");
-    jfieldID newEndByte = env->GetFieldID(javaTSInputEditClass, "newEndByte", "I");
-   
-    jfieldID startPoint = env->GetFieldID(javaTSInputEditClass, "startPoint", "Lio/github/module/treesitter/TSPoint;");
-    jfieldID oldEndPoint = env->GetFieldID(javaTSInputEditClass, "oldEndPoint", "Lio/github/module/treesitter/TSPoint;");
-    jfieldID newEndPoint = env->GetFieldID(javaTSInputEditClass, "newEndPoint", "Lio/github/module/treesitter/TSPoint;");
-   
     TSInputEdit tsInput {
-        static_cast<uint32_t>(env->GetIntField(inputEdit, startByte)),
-        static_cast<uint32_t>(env->GetIntField(inputEdit, oldEndByte)),
-        static_cast<uint32_t>(env->GetIntField(inputEdit, newEndByte)),
-        nativePoint(env, env->GetObjectField(inputEdit, startPoint)),
-        nativePoint(env, env->GetObjectField(inputEdit, oldEndPoint)),
-        nativePoint(env, env->GetObjectField(inputEdit, newEndPoint))
+        static_cast<uint32_t>(env->GetIntField(inputEdit, javaTSInputEditStartByte)),
+        static_cast<uint32_t>(env->GetIntField(inputEdit, javaTSInputEditOldEndByte)),
+        static_cast<uint32_t>(env->GetIntField(inputEdit, javaTSInputEditNewEndByte)),
+        nativePoint(env, env->GetObjectField(inputEdit, javaTSInputEditStartPoint)),
+        nativePoint(env, env->GetObjectField(inputEdit, javaTSInputEditOldEndPoint)),
+        nativePoint(env, env->GetObjectField(inputEdit, javaTSInputEditNewEndPoint))
     };
     
+    KindScope scope(MEMORY_KIND_TREE);
     ts_tree_edit(reinterpret_cast<TSTree*>(tree), &tsInput);
 }
 
@@ -123,7 +207,7 @@ Java_io_github_module_treesitter_TreeSitter_editTree(JNIEnv* env, jobject thiz,
  * The returned pointer must be freed by the caller.
  */
 JNIEXPORT jobjectArray JNICALL
-Java_io_github_module_treesitter_TreeSitter_getTreeIncluedRanges(JNIEnv* env, jobject thiz, jlong tree) {
+Java_io_github_module_treesitter_TreeSitter_getTreeIncludedRanges(JNIEnv* env, jobject thiz, jlong tree) {
     uint32_t length;
     TSRange *ranges = ts_tree_included_ranges(
         reinterpret_cast<TSTree*>(tree),
@@ -176,6 +260,156 @@ Java_io_github_module_treesitter_TreeSitter_treeDotGraph(JNIEnv* env, jobject th
     env->ReleaseStringUTFChars(pathname, path);
 }
 
+// walk the tree in pre-order once and append the 9 ints of every node
+// to the rows, the vector grows with the tree so no counting walk is needed
+static uint32_t flattenNodes(TSTree *tree, std::vector<int32_t> *rows) {
+    TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+    // the index of the current parent on each depth
+    std::vector<int32_t> parents;
+    parents.push_back(-1);
+    uint32_t index = 0;
+    rows->clear();
+    
+    for(;;) {
+        TSNode node = ts_tree_cursor_current_node(&cursor);
+        TSPoint startPoint = ts_node_start_point(node);
+        TSPoint endPoint = ts_node_end_point(node);
+        int32_t flags = 0;
+        if(ts_node_is_named(node)) flags |= FLAT_FLAG_NAMED;
+        if(ts_node_is_missing(node)) flags |= FLAT_FLAG_MISSING;
+        if(ts_node_is_extra(node)) flags |= FLAT_FLAG_EXTRA;
+        if(ts_node_has_error(node)) flags |= FLAT_FLAG_HAS_ERROR;
+        
+        const int32_t row[FLAT_COLUMN_COUNT] = {
+            ts_node_symbol(node),
+            parents.back(),
+            static_cast<int32_t>(ts_node_start_byte(node)),
+            static_cast<int32_t>(ts_node_end_byte(node)),
+            static_cast<int32_t>(startPoint.row),
+            static_cast<int32_t>(startPoint.column),
+            static_cast<int32_t>(endPoint.row),
+            static_cast<int32_t>(endPoint.column),
+            flags
+        };
+        rows->insert(rows->end(), row, row + FLAT_COLUMN_COUNT);
+        
+        if(ts_tree_cursor_goto_first_child(&cursor)) {
+            parents.push_back(index++);
+            continue;
+        }
+        index++;
+        while(!ts_tree_cursor_goto_next_sibling(&cursor)) {
+            if(!ts_tree_cursor_goto_parent(&cursor)) {
+                ts_tree_cursor_delete(&cursor);
+                return index;
+            }
+            parents.pop_back();
+        }
+    }
+}
+
+// transpose the rows into the columns, the column k of the node i is 
+// stored at data[k * count + i], the data does not need to be aligned
+static void writeColumns(const std::vector<int32_t> &rows, const uint32_t count, char *data) {
+    for(uint32_t k = 0; k < FLAT_COLUMN_COUNT; ++k) {
+        for(uint32_t i = 0; i < count; ++i) {
+            memcpy(data + (static_cast<size_t>(k) * count + i) * sizeof(int32_t), 
+                        &rows[static_cast<size_t>(i) * FLAT_COLUMN_COUNT + k], sizeof(int32_t));
+        }
+    }
+}
+
+// the rows are reused by the next flatten on the same thread
+static std::vector<int32_t> *flatRows() {
+    static thread_local std::vector<int32_t> rows;
+    return &rows;
+}
+
+/**
+ * Get the number of nodes in the syntax tree, this is the row count
+ * of the flattened tree.
+ */
+JNIEXPORT jint JNICALL
+Java_io_github_module_treesitter_TreeSitter_treeNodeCount(JNIEnv* env, jobject thiz, jlong tree) {
+    TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(reinterpret_cast<TSTree*>(tree)));
+    jint count = 0;
+    
+    for(;;) {
+        count++;
+        if(ts_tree_cursor_goto_first_child(&cursor)) continue;
+        while(!ts_tree_cursor_goto_next_sibling(&cursor)) {
+            if(!ts_tree_cursor_goto_parent(&cursor)) {
+                ts_tree_cursor_delete(&cursor);
+                return count;
+            }
+        }
+    }
+}
+
+/**
+ * Flatten the syntax tree into a new int array with a single walk.
+ *
+ * The array holds 9 columns of node count ints each: symbol, parent index,
+ * start byte, end byte, start row, start column, end row, end column and
+ * flags.
+ */
+JNIEXPORT jintArray JNICALL
+Java_io_github_module_treesitter_TreeSitter_flattenTreeArray(JNIEnv* env, jobject thiz, jlong tree) {
+    std::vector<int32_t> *rows = flatRows();
+    uint32_t count = flattenNodes(reinterpret_cast<TSTree*>(tree), rows);
+    
+    jintArray array = env->NewIntArray(static_cast<jsize>(rows->size()));
+    if(array == nullptr) return nullptr;
+    // no JNI calls happen during the copy
+    jint *data = reinterpret_cast<jint*>(env->GetPrimitiveArrayCritical(array, nullptr));
+    writeColumns(*rows, count, reinterpret_cast<char*>(data));
+    env->ReleasePrimitiveArrayCritical(array, data, 0);
+    return array;
+}
+
+/**
+ * Flatten the syntax tree into the given int array with a single walk, the 
+ * layout is the same as `flattenTreeArray`. Returns the node count, or the 
+ * negative node count without writing anything when the array is too small.
+ */
+JNIEXPORT jint JNICALL
+Java_io_github_module_treesitter_TreeSitter_flattenTree(JNIEnv* env, jobject thiz, 
+                                                        jlong tree, jintArray array) {
+    std::vector<int32_t> *rows = flatRows();
+    uint32_t count = flattenNodes(reinterpret_cast<TSTree*>(tree), rows);
+    if(static_cast<jlong>(env->GetArrayLength(array)) < static_cast<jlong>(rows->size()))
+        return -static_cast<jint>(count);
+    
+    jint *data = reinterpret_cast<jint*>(env->GetPrimitiveArrayCritical(array, nullptr));
+    writeColumns(*rows, count, reinterpret_cast<char*>(data));
+    env->ReleasePrimitiveArrayCritical(array, data, 0);
+    return count;
+}
+
+/**
+ * Flatten the syntax tree into the given direct byte buffer starting at
+ * the position, the layout is the same as `flattenTreeArray` with ints in 
+ * the native byte order. The remaining bytes must hold all columns.
+ */
+JNIEXPORT jint JNICALL
+Java_io_github_module_treesitter_TreeSitter_flattenTreeBuffer(JNIEnv* env, jobject thiz, 
+                                                              jlong tree, jobject buffer, 
+                                                              jint position, jint remaining) {
+    std::vector<int32_t> *rows = flatRows();
+    uint32_t count = flattenNodes(reinterpret_cast<TSTree*>(tree), rows);
+    char *data = reinterpret_cast<char*>(env->GetDirectBufferAddress(buffer));
+    if(data == nullptr) {
+        LOGE("Error: the buffer is not a direct buffer\n");
+        return -static_cast<jint>(count);
+    }
+    
+    if(static_cast<jlong>(remaining) < static_cast<jlong>(rows->size()) * static_cast<jlong>(sizeof(int32_t)))
+        return -static_cast<jint>(count);
+    
+    writeColumns(*rows, count, data + position);
+    return count;
+}
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
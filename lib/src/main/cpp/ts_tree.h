@@ -0,0 +1,62 @@
+/*
+ * Copyright © 2023 Github Lzhiyong
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TS_TREE_H__
+#define __TS_TREE_H__
+
+#include <jni.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <tree_sitter/api.h>
+
+// the source text retained by a tree, either a copy of 
+// the parsed bytes or the mapping of the parsed file
+struct TreeSource {
+    std::string text;
+    void *mapping = nullptr;
+    size_t mappingLength = 0;
+    TSInputEncoding encoding = TSInputEncodingUTF8;
+    
+    const char *data() const {
+        return mapping != nullptr ? static_cast<const char*>(mapping) : text.data();
+    }
+    
+    size_t length() const {
+        return mapping != nullptr ? mappingLength : text.size();
+    }
+    
+    ~TreeSource();
+};
+
+// a source is owned by the handles stored on the kotlin trees, every handle 
+// holds a reference so a tree copy shares the source of its tree
+typedef std::shared_ptr<TreeSource> TreeSourceHandle;
+
+// write a new handle of the source into handles[0], nothing is written 
+// if the handles are null
+void storeTreeSource(JNIEnv*, jlongArray, const jsize, std::shared_ptr<TreeSource>);
+
+// the source of the handle or null
+inline const TreeSource *treeSource(const jlong handle) {
+    return handle != 0 ? reinterpret_cast<TreeSourceHandle*>(handle)->get() : nullptr;
+}
+
+// the bytes [start, end) of the source as a java string, the 
+// scratch buffer is reused by the bulk calls
+jstring javaSourceText(JNIEnv*, const TreeSource*, uint32_t, uint32_t, std::vector<jchar>*);
+
+#endif // __TS_TREE_H__
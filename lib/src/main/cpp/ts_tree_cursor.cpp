@@ -14,23 +14,49 @@
  * limitations under the License.
  */
 
+#include <mutex>
+#include <vector>
 #include <tree_sitter/api.h>
 
+#include "ts_allocator.h"
 #include "ts_utils.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// the idle cursors, a cursor keeps its stack allocation and is
+// reset onto the next node instead of being allocated again
+#define CURSOR_POOL_CAPACITY 64
+static std::mutex cursorPoolMutex;
+static std::vector<TSTreeCursor*> cursorPool;
+
 /**
  * Create a new tree cursor starting from the given node.
  *
  * A tree cursor allows you to walk a syntax tree more efficiently than is
  * possible using the `TSNode` functions. It is a mutable object that is always
  * on a certain syntax node, and can be moved imperatively to different nodes.
+ *
+ * An idle cursor of the pool is reset onto the node if there is one.
  */
 JNIEXPORT jlong JNICALL
 Java_io_github_module_treesitter_TreeSitter_newTreeCursor(JNIEnv* env, jobject thiz, jobject node) {
+    TSTreeCursor *cursor = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(cursorPoolMutex);
+        if(!cursorPool.empty()) {
+            cursor = cursorPool.back();
+            cursorPool.pop_back();
+        }
+    }
+    
+    KindScope scope(MEMORY_KIND_TREE_CURSOR);
+    if(cursor != nullptr) {
+        ts_tree_cursor_reset(cursor, nativeNode(env, node));
+        return reinterpret_cast<jlong>(cursor);
+    }
+    
     return reinterpret_cast<jlong>(
         new TSTreeCursor(ts_tree_cursor_new(nativeNode(env, node)))
     );
@@ -38,10 +64,44 @@ Java_io_github_module_treesitter_TreeSitter_newTreeCursor(JNIEnv* env, jobject t
 
 /**
  * Delete a tree cursor, freeing all of the memory that it used.
+ *
+ * The cursor goes back to the pool unless the pool is full or its stack
+ * was allocated from an arena.
  */
 JNIEXPORT void JNICALL
 Java_io_github_module_treesitter_TreeSitter_deleteTreeCursor(JNIEnv* env, jobject thiz, jlong cursor) {
-    ts_tree_cursor_delete(reinterpret_cast<TSTreeCursor*>(cursor));
+    TSTreeCursor *treeCursor = reinterpret_cast<TSTreeCursor*>(cursor);
+    // the id of the cursor is its stack, a stack of an arena dies with the arena
+    if(!isArenaBlock(treeCursor->id)) {
+        std::lock_guard<std::mutex> lock(cursorPoolMutex);
+        if(cursorPool.size() < CURSOR_POOL_CAPACITY) {
+            cursorPool.push_back(treeCursor);
+            return;
+        }
+    }
+    
+    ts_tree_cursor_delete(treeCursor);
+    delete treeCursor;
+}
+
+/**
+ * Re-initialize a tree cursor to start at a different node.
+ */
+JNIEXPORT void JNICALL
+Java_io_github_module_treesitter_TreeSitter_resetTreeCursor(JNIEnv* env, jobject thiz, 
+                                                            jlong cursor, jobject node) {
+    ts_tree_cursor_reset(reinterpret_cast<TSTreeCursor*>(cursor), nativeNode(env, node));
+}
+
+/**
+ * Create a copy of the tree cursor, the copy is independent of the original.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_copyTreeCursor(JNIEnv* env, jobject thiz, jlong cursor) {
+    KindScope scope(MEMORY_KIND_TREE_CURSOR);
+    return reinterpret_cast<jlong>(
+        new TSTreeCursor(ts_tree_cursor_copy(reinterpret_cast<TSTreeCursor*>(cursor)))
+    );
 }
 
 /**
@@ -63,6 +123,17 @@ Java_io_github_module_treesitter_TreeSitter_cursorCurrentFieldName(JNIEnv* env,
     return env->NewStringUTF(name);
 }
 
+/**
+ * Get the field id of the tree cursor's current node.
+ *
+ * This returns zero if the current node doesn't have a field.
+ * See also `ts_node_child_by_field_id`, `ts_language_field_id_for_name`.
+ */
+JNIEXPORT jint JNICALL
+Java_io_github_module_treesitter_TreeSitter_cursorCurrentFieldId(JNIEnv* env, jobject thiz, jlong cursor) {
+    return ts_tree_cursor_current_field_id(reinterpret_cast<TSTreeCursor*>(cursor));
+}
+
 JNIEXPORT jboolean JNICALL
 Java_io_github_module_treesitter_TreeSitter_cursorGotoFirstChild(JNIEnv* env, jobject thiz, jlong cursor) {
     return ts_tree_cursor_goto_first_child(
@@ -84,6 +155,107 @@ Java_io_github_module_treesitter_TreeSitter_cursorGotoParent(JNIEnv* env, jobjec
     );
 }
 
+/**
+ * Move the cursor to the first child of its current node that extends beyond
+ * the given byte offset or point.
+ *
+ * This returns the index of the child node if one was found, and returns -1
+ * if no such child was found.
+ */
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_cursorGotoFirstChildForByte(JNIEnv* env, jobject thiz, 
+                                                                        jlong cursor, jint byte) {
+    return ts_tree_cursor_goto_first_child_for_byte(reinterpret_cast<TSTreeCursor*>(cursor), byte);
+}
+
+JNIEXPORT jlong JNICALL
+Java_io_github_module_treesitter_TreeSitter_cursorGotoFirstChildForPoint(JNIEnv* env, jobject thiz, 
+                                                                         jlong cursor, jint row, jint column) {
+    return ts_tree_cursor_goto_first_child_for_point(
+        reinterpret_cast<TSTreeCursor*>(cursor),
+        {static_cast<uint32_t>(row), static_cast<uint32_t>(column)}
+    );
+}
+
+// the ints written for each visited node: depth, symbol, 
+// start byte, end byte and field id
+#define WALK_TUPLE_SIZE 5
+// the state flags of a walk
+#define WALK_LEAVING 0x01
+#define WALK_FINISHED 0x02
+
+/**
+ * Walk the subtree of the cursor's current node, advancing the cursor as many
+ * steps as the buffer allows, and write a tuple of 5 ints for each visited
+ * node: depth, symbol, start byte, end byte and field id. The nodes are
+ * written in pre-order, or in post-order if `postorder` is true, the
+ * anonymous nodes are skipped if `namedOnly` is true, and the walk does not
+ * descend below `maxDepth` unless it is negative.
+ *
+ * The walk can be resumed with the same cursor and state array: the state
+ * holds the depth relative to the start node and the walk flags. Returns the
+ * number of tuples written, zero once the walk is finished.
+ */
+JNIEXPORT jint JNICALL
+Java_io_github_module_treesitter_TreeSitter_cursorWalk(JNIEnv* env, jobject thiz, jlong cursor, 
+                                                       jintArray buffer, jintArray state, jboolean postorder, 
+                                                       jboolean namedOnly, jint maxDepth) {
+    TSTreeCursor *treeCursor = reinterpret_cast<TSTreeCursor*>(cursor);
+    jint walkState[2];
+    env->GetIntArrayRegion(state, 0, 2, walkState);
+    jint depth = walkState[0];
+    jint flags = walkState[1];
+    if(flags & WALK_FINISHED) 
+        return 0;
+    
+    const jsize capacity = env->GetArrayLength(buffer) / WALK_TUPLE_SIZE;
+    jsize count = 0;
+    // no JNI calls happen during the walk
+    jint *data = static_cast<jint*>(env->GetPrimitiveArrayCritical(buffer, nullptr));
+    
+    for(;;) {
+        bool leaving = flags & WALK_LEAVING;
+        // visit the node when entering it in pre-order, or leaving it in post-order
+        if(leaving == static_cast<bool>(postorder)) {
+            TSNode node = ts_tree_cursor_current_node(treeCursor);
+            if(!namedOnly || ts_node_is_named(node)) {
+                if(count == capacity) break;
+                jint *tuple = data + count * WALK_TUPLE_SIZE;
+                tuple[0] = depth;
+                tuple[1] = ts_node_symbol(node);
+                tuple[2] = ts_node_start_byte(node);
+                tuple[3] = ts_node_end_byte(node);
+                tuple[4] = ts_tree_cursor_current_field_id(treeCursor);
+                count++;
+            }
+        }
+        
+        if(!leaving) {
+            if((maxDepth < 0 || depth < maxDepth) && ts_tree_cursor_goto_first_child(treeCursor)) {
+                depth++;
+            } else {
+                flags |= WALK_LEAVING;
+            }
+        } else if(depth == 0) {
+            // back at the start node
+            flags |= WALK_FINISHED;
+            break;
+        } else if(ts_tree_cursor_goto_next_sibling(treeCursor)) {
+            flags &= ~WALK_LEAVING;
+        } else {
+            ts_tree_cursor_goto_parent(treeCursor);
+            depth--;
+        }
+    }
+    
+    env->ReleasePrimitiveArrayCritical(buffer, data, 0);
+    
+    walkState[0] = depth;
+    walkState[1] = flags;
+    env->SetIntArrayRegion(state, 0, 2, walkState);
+    return count;
+}
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
@@ -16,6 +16,7 @@
 
 #include <regex>
 #include <string>
+#include <vector>
 
 #include "ts_utils.h"
 
@@ -27,18 +28,53 @@ extern "C" {
 extern jclass javaTSNodeClass;
 extern jclass javaTSPointClass;
 
+// define global variables
+jclass javaTSQueryErrorClass = nullptr;
+jclass javaIOExceptionClass = nullptr;
+jclass javaIllegalStateExceptionClass = nullptr;
+jclass javaIllegalArgumentExceptionClass = nullptr;
+jclass javaTSQueryCapturesClass = nullptr;
+
+jmethodID javaTSNodeConstructor = nullptr;
+jfieldID javaTSNodeContext[4] = {nullptr};
+jfieldID javaTSNodeId = nullptr;
+jfieldID javaTSNodeTree = nullptr;
+
+jmethodID javaTSPointConstructor = nullptr;
+jfieldID javaTSPointRow = nullptr;
+jfieldID javaTSPointColumn = nullptr;
+
+jmethodID javaTSRangeConstructor = nullptr;
+
+jfieldID javaTSInputEditStartByte = nullptr;
+jfieldID javaTSInputEditOldEndByte = nullptr;
+jfieldID javaTSInputEditNewEndByte = nullptr;
+jfieldID javaTSInputEditStartPoint = nullptr;
+jfieldID javaTSInputEditOldEndPoint = nullptr;
+jfieldID javaTSInputEditNewEndPoint = nullptr;
+
+jmethodID javaTSCaptureConstructor = nullptr;
+jmethodID javaTSQueryCaptureConstructor = nullptr;
+jmethodID javaTSQueryMatchConstructor = nullptr;
+jmethodID javaTSQueryPredicateStepConstructor = nullptr;
+jmethodID javaTSQueryCapturesConstructor = nullptr;
+
+jfieldID javaEnumOrdinal = nullptr;
+
+jobject javaTSLogTypes[2] = {nullptr};
+jobject javaTSQuantifiers[5] = {nullptr};
+jobject javaTSQueryErrors[7] = {nullptr};
+jobject javaTSQueryPredicateStepTypes[3] = {nullptr};
+
 // java TSNode
 jobject javaNode(JNIEnv *env, const TSNode *node) {
-    jmethodID constructor = env->GetMethodID(javaTSNodeClass, "<init>", "([IJJ)V");
-    // size default is 4
-    jint size = sizeof(node->context) / sizeof(node->context[0]);
-    jintArray javaArray = env->NewIntArray(size);
-    env->SetIntArrayRegion(javaArray, 0, size, (jint*)node->context);
-    
     return env->NewObject(
         javaTSNodeClass, 
-        constructor, 
-        javaArray,
+        javaTSNodeConstructor, 
+        node->context[0],
+        node->context[1],
+        node->context[2],
+        node->context[3],
         reinterpret_cast<jlong>(node->id),
         reinterpret_cast<jlong>(node->tree)
     );
@@ -46,28 +82,38 @@ jobject javaNode(JNIEnv *env, const TSNode *node) {
 
 // native TSNode
 TSNode nativeNode(JNIEnv *env, const jobject nodeObject) {
-    jfieldID context = env->GetFieldID(javaTSNodeClass, "context", "[I");
-    jfieldID id = env->GetFieldID(javaTSNodeClass, "id", "J");
-    jfieldID tree = env->GetFieldID(javaTSNodeClass, "tree", "J");
-    
-    jintArray array = static_cast<jintArray>(env->GetObjectField(nodeObject, context));
-    // jint size = env->GetArrayLength(array);
-    uint32_t node_ctx[4];
-    env->GetIntArrayRegion(array, 0, 4, (jint*)node_ctx);
-    
     return TSNode {
-        {node_ctx[0], node_ctx[1], node_ctx[2], node_ctx[3]},
-        reinterpret_cast<const void*>(env->GetLongField(nodeObject, id)),
-        reinterpret_cast<const TSTree*>(env->GetLongField(nodeObject, tree))
+        {
+            static_cast<uint32_t>(env->GetIntField(nodeObject, javaTSNodeContext[0])),
+            static_cast<uint32_t>(env->GetIntField(nodeObject, javaTSNodeContext[1])),
+            static_cast<uint32_t>(env->GetIntField(nodeObject, javaTSNodeContext[2])),
+            static_cast<uint32_t>(env->GetIntField(nodeObject, javaTSNodeContext[3]))
+        },
+        reinterpret_cast<const void*>(env->GetLongField(nodeObject, javaTSNodeId)),
+        reinterpret_cast<const TSTree*>(env->GetLongField(nodeObject, javaTSNodeTree))
+    };
+}
+
+// native TSNode from the primitive fields of java TSNode
+TSNode primitiveNode(jint context0, jint context1, jint context2, jint context3, 
+                     jlong id, jlong tree) {
+    return TSNode {
+        {
+            static_cast<uint32_t>(context0), 
+            static_cast<uint32_t>(context1), 
+            static_cast<uint32_t>(context2), 
+            static_cast<uint32_t>(context3)
+        },
+        reinterpret_cast<const void*>(id),
+        reinterpret_cast<const TSTree*>(tree)
     };
 }
 
 // java TSPoint
 jobject javaPoint(JNIEnv *env, const TSPoint *point) {
-    jmethodID constructor = env->GetMethodID(javaTSPointClass, "<init>", "(II)V");
     return env->NewObject(
         javaTSPointClass, 
-        constructor,
+        javaTSPointConstructor,
         point->row,
         point->column
     );
@@ -75,14 +121,110 @@ jobject javaPoint(JNIEnv *env, const TSPoint *point) {
 
 // native TSPoint
 TSPoint nativePoint(JNIEnv *env, const jobject pointObject) {
-    jfieldID row = env->GetFieldID(javaTSPointClass, "row", "I");
-    jfieldID column = env->GetFieldID(javaTSPointClass, "column", "I");
     return TSPoint {
-        static_cast<uint32_t>(env->GetIntField(pointObject, row)),
-        static_cast<uint32_t>(env->GetIntField(pointObject, column))
+        static_cast<uint32_t>(env->GetIntField(pointObject, javaTSPointRow)),
+        static_cast<uint32_t>(env->GetIntField(pointObject, javaTSPointColumn))
     };
 }
 
+// native TSInputEncoding
+TSInputEncoding nativeEncoding(JNIEnv *env, const jobject encodingObject) {
+    return static_cast<TSInputEncoding>(env->GetIntField(encodingObject, javaEnumOrdinal));
+}
+
+// java TSQueryCaptures, the columns hold count ints each
+jobject javaQueryCaptureColumns(JNIEnv *env, const jint count, const jint *columns, const jlong *ids) {
+    jintArray columnArray = env->NewIntArray(count * CAPTURE_COLUMN_COUNT);
+    jlongArray idArray = env->NewLongArray(count);
+    env->SetIntArrayRegion(columnArray, 0, count * CAPTURE_COLUMN_COUNT, columns);
+    env->SetLongArrayRegion(idArray, 0, count, ids);
+    
+    jobject capturesObject = env->NewObject(
+        javaTSQueryCapturesClass,
+        javaTSQueryCapturesConstructor,
+        count,
+        columnArray,
+        idArray
+    );
+    
+    env->DeleteLocalRef(columnArray);
+    env->DeleteLocalRef(idArray);
+    return capturesObject;
+}
+
+// UTF-16 to UTF-8, the unpaired surrogates become U+FFFD
+void utf16ToUtf8(const jchar *chars, const uint32_t length, std::string *output) {
+    output->reserve(output->size() + length);
+    
+    for(uint32_t i=0; i < length; ++i) {
+        uint32_t code = chars[i];
+        if(code >= 0xD800 && code <= 0xDBFF && i + 1 < length 
+           && chars[i + 1] >= 0xDC00 && chars[i + 1] <= 0xDFFF) {
+            code = 0x10000 + ((code - 0xD800) << 10) + (chars[++i] - 0xDC00);
+        } else if(code >= 0xD800 && code <= 0xDFFF) {
+            code = 0xFFFD;
+        }
+        
+        if(code < 0x80) {
+            output->push_back(static_cast<char>(code));
+        } else if(code < 0x800) {
+            output->push_back(static_cast<char>(0xC0 | (code >> 6)));
+            output->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if(code < 0x10000) {
+            output->push_back(static_cast<char>(0xE0 | (code >> 12)));
+            output->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            output->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            output->push_back(static_cast<char>(0xF0 | (code >> 18)));
+            output->push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            output->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            output->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+}
+
+// UTF-8 to UTF-16, the invalid sequences become U+FFFD
+void utf8ToUtf16(const char *bytes, const uint32_t length, std::vector<jchar> *output) {
+    output->reserve(output->size() + length);
+    const uint8_t *text = reinterpret_cast<const uint8_t*>(bytes);
+    
+    for(uint32_t i=0; i < length;) {
+        uint32_t code = text[i];
+        uint32_t size = code < 0x80 ? 1 : code >= 0xF0 ? 4 : code >= 0xE0 ? 3 : code >= 0xC2 ? 2 : 0;
+        if(size == 0 || i + size > length) {
+            output->push_back(0xFFFD);
+            i++;
+            continue;
+        }
+        
+        if(size > 1) code &= 0xFF >> (size + 1);
+        bool valid = true;
+        for(uint32_t k=1; k < size; ++k) {
+            if((text[i + k] & 0xC0) != 0x80) {
+                valid = false;
+                break;
+            }
+            code = (code << 6) | (text[i + k] & 0x3F);
+        }
+        // overlong forms, surrogates and code points above U+10FFFF
+        if(!valid || (size == 3 && code < 0x800) || (size == 4 && (code < 0x10000 || code > 0x10FFFF))
+           || (code >= 0xD800 && code <= 0xDFFF)) {
+            output->push_back(0xFFFD);
+            i++;
+            continue;
+        }
+        
+        if(code >= 0x10000) {
+            code -= 0x10000;
+            output->push_back(static_cast<jchar>(0xD800 + (code >> 10)));
+            output->push_back(static_cast<jchar>(0xDC00 + (code & 0x3FF)));
+        } else {
+            output->push_back(static_cast<jchar>(code));
+        }
+        i += size;
+    }
+}
+
 // get lambda callable object
 jmethodID getMethod(JNIEnv *env, const jobject object, const char *signature) {
     jclass clazz = env->GetObjectClass(object);
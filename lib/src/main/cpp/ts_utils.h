@@ -18,24 +18,85 @@
 #define __TS_UTILS_H__
 
 #include <jni.h>
+#include <string>
+#include <vector>
 #include <tree_sitter/api.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// cached java classes, method ids, field ids and enum constants,
+// they are resolved once in JNI_OnLoad, see jni_helper.cpp
+extern jclass javaTSQueryErrorClass;
+extern jclass javaIOExceptionClass;
+extern jclass javaIllegalStateExceptionClass;
+extern jclass javaIllegalArgumentExceptionClass;
+extern jclass javaTSQueryCapturesClass;
+
+extern jmethodID javaTSNodeConstructor;
+extern jfieldID javaTSNodeContext[4];
+extern jfieldID javaTSNodeId;
+extern jfieldID javaTSNodeTree;
+
+extern jmethodID javaTSPointConstructor;
+extern jfieldID javaTSPointRow;
+extern jfieldID javaTSPointColumn;
+
+extern jmethodID javaTSRangeConstructor;
+
+extern jfieldID javaTSInputEditStartByte;
+extern jfieldID javaTSInputEditOldEndByte;
+extern jfieldID javaTSInputEditNewEndByte;
+extern jfieldID javaTSInputEditStartPoint;
+extern jfieldID javaTSInputEditOldEndPoint;
+extern jfieldID javaTSInputEditNewEndPoint;
+
+extern jmethodID javaTSCaptureConstructor;
+extern jmethodID javaTSQueryCaptureConstructor;
+extern jmethodID javaTSQueryMatchConstructor;
+extern jmethodID javaTSQueryPredicateStepConstructor;
+extern jmethodID javaTSQueryCapturesConstructor;
+
+// java.lang.Enum ordinal
+extern jfieldID javaEnumOrdinal;
+
+// enum constants, indexed by the native enum value
+extern jobject javaTSLogTypes[2];
+extern jobject javaTSQuantifiers[5];
+extern jobject javaTSQueryErrors[7];
+extern jobject javaTSQueryPredicateStepTypes[3];
+
 // native TSNode -> java TSNode
 jobject javaNode(JNIEnv*, const TSNode*);
 
 // java TSNode -> native TSNode
 TSNode nativeNode(JNIEnv*, const jobject);
 
+// java TSNode primitive fields -> native TSNode
+TSNode primitiveNode(jint, jint, jint, jint, jlong, jlong);
+
 // native TSPoint -> java TSPoint
 jobject javaPoint(JNIEnv*, const TSPoint*);
 
 // java TSPoint -> native TSPoint
 TSPoint nativePoint(JNIEnv*, const jobject);
 
+// java TSInputEncoding -> native TSInputEncoding
+TSInputEncoding nativeEncoding(JNIEnv*, const jobject);
+
+// the columns of the packed captures, see TSQueryCaptures
+#define CAPTURE_COLUMN_COUNT 9
+
+// packed capture columns -> java TSQueryCaptures
+jobject javaQueryCaptureColumns(JNIEnv*, const jint, const jint*, const jlong*);
+
+// UTF-16 code units -> UTF-8 string, appended to the output
+void utf16ToUtf8(const jchar*, const uint32_t, std::string*);
+
+// UTF-8 bytes -> UTF-16 code units, appended to the output
+void utf8ToUtf16(const char*, const uint32_t, std::vector<jchar>*);
+
 // get callable object from kotlin lambda
 jmethodID getMethod(JNIEnv*, const jobject, const char*);
 
@@ -0,0 +1,93 @@
+/*
+ * Copyright © 2023 Github Lzhiyong
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.module.treesitter
+
+import java.io.Closeable
+
+data class TSMemoryUsage(
+    val liveBytes: Long,
+    val liveCount: Long,
+    val totalCount: Long
+)
+
+// a snapshot of the native memory of tree-sitter, the blocks 
+// allocated from an arena are only counted in arenaBytes
+class TSMemoryStats internal constructor(private val values: LongArray) {
+    
+    fun usage(kind: TSMemoryKind): TSMemoryUsage {
+        val index = kind.ordinal * 3
+        return TSMemoryUsage(values[index], values[index + 1], values[index + 2])
+    }
+    
+    // the live bytes of all kinds
+    val liveBytes: Long
+        get() = TSMemoryKind.values().sumOf { values[it.ordinal * 3] }
+    
+    // the bytes reserved by the arenas of all threads
+    val arenaBytes: Long
+        get() = values[values.size - 1]
+    
+    override fun toString(): String {
+        val kinds = TSMemoryKind.values().joinToString { "$it=${usage(it)}" }
+        return "TSMemoryStats($kinds, arenaBytes=$arenaBytes)"
+    }
+}
+
+object TSAllocator {
+    // every block remembers where it came from, 
+    // the mode can be changed at any time
+    var mode: TSAllocatorMode
+        get() = TSAllocatorMode.values()[TreeSitter.getAllocatorMode()]
+        set(value) = TreeSitter.setAllocatorMode(value)
+    
+    // the counters are read without a lock, the call is cheap
+    fun memoryStats(): TSMemoryStats {
+        return TSMemoryStats(TreeSitter.memoryStats())
+    }
+}
+
+// the parsers created by newParser and the trees they parse are allocated from 
+// the arena, the memory is released at once and freeing a single block costs 
+// nothing, everything else is allocated from the heap. A parser of the arena 
+// only parses on the thread that created the arena while it is the innermost 
+// arena of that thread. The parsers and trees of the arena, copies included, 
+// must be closed before the arena. The arena must be closed on the thread 
+// that created it, arenas can be nested
+class TSArena(chunkSize: Int = 64 * 1024) : Pointer(), Closeable {
+    
+    init {
+        // init native arena pointer
+        this.pointer = TreeSitter.beginArena(chunkSize)
+    }
+    
+    // the bytes allocated from the arena
+    val size: Long
+        get() = TreeSitter.arenaSize(this.pointer)
+    
+    // a parser allocating itself and its trees from the arena, 
+    // the parser is never pooled
+    fun newParser(): TSParser {
+        return TSParser(TreeSitter.newArenaParser(this.pointer)).also { it.arena = this.pointer }
+    }
+    
+    override fun close() {
+        check(TreeSitter.endArena(this.pointer)) { 
+            "the arena is not the innermost arena or its parsers and trees are not closed" 
+        }
+    }
+}
+
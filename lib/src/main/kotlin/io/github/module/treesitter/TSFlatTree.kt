@@ -0,0 +1,51 @@
+/*
+ * Copyright © 2023 Github Lzhiyong
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.module.treesitter
+
+// the struct-of-arrays encoding of a syntax tree in pre-order,
+// the column k of the node i is stored at data[k * count + i]
+class TSFlatTree(val count: Int, val data: IntArray) {
+    
+    fun symbol(index: Int) = data[index]
+    
+    // the index of the parent node, -1 for the root node
+    fun parent(index: Int) = data[count + index]
+    
+    fun startByte(index: Int) = data[2 * count + index]
+    
+    fun endByte(index: Int) = data[3 * count + index]
+    
+    fun startPoint(index: Int) = TSPoint(data[4 * count + index], data[5 * count + index])
+    
+    fun endPoint(index: Int) = TSPoint(data[6 * count + index], data[7 * count + index])
+    
+    fun isNamed(index: Int) = data[8 * count + index] and FLAG_NAMED != 0
+    
+    fun isMissing(index: Int) = data[8 * count + index] and FLAG_MISSING != 0
+    
+    fun isExtra(index: Int) = data[8 * count + index] and FLAG_EXTRA != 0
+    
+    fun hasError(index: Int) = data[8 * count + index] and FLAG_HAS_ERROR != 0
+    
+    companion object {
+        const val COLUMN_COUNT = 9
+        const val FLAG_NAMED = 0x01
+        const val FLAG_MISSING = 0x02
+        const val FLAG_EXTRA = 0x04
+        const val FLAG_HAS_ERROR = 0x08
+    }
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright © 2023 Github Lzhiyong
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.module.treesitter
+
+import java.io.Closeable
+
+// highlights the visible rows of a document, the spans of every row are cached
+// and only the rows touched by the edits or the changed ranges are queried again,
+// the spans are 3 ints each: startByte, endByte, captureId
+class TSHighlighter(private val query: TSQuery) : Pointer(), Closeable {
+    
+    init {
+        // init native highlighter pointer
+        this.pointer = TreeSitter.newHighlighter(query.pointer)
+    }
+    
+    // the edits are 9 ints each, see TSParser.reparse
+    fun edit(edits: IntArray) {
+        require(edits.size % 9 == 0) { "the edits must be 9 ints each" }
+        TreeSitter.highlighterEdit(this.pointer, edits)
+    }
+    
+    fun edit(input: TSInputEdit) {
+        edit(intArrayOf(
+            input.startByte, input.oldEndByte, input.newEndByte,
+            input.startPoint.row, input.startPoint.column,
+            input.oldEndPoint.row, input.oldEndPoint.column,
+            input.newEndPoint.row, input.newEndPoint.column
+        ))
+    }
+    
+    // the tree parsed after the edits
+    // the highlighter outlives any arena, the tree must not be allocated from one
+    fun setTree(tree: TSTree) {
+        require(tree.arena == nullptr) { "the tree of a highlighter can not be allocated from an arena" }
+        TreeSitter.highlighterSetTree(this.pointer, tree.pointer)
+    }
+    
+    // the spans of the rows [startRow, endRow), the source enables the text predicates
+    fun highlight(
+        startRow: Int,
+        endRow: Int,
+        source: ByteArray? = null,
+        encoding: TSInputEncoding = TSInputEncoding.UTF8
+    ): IntArray {
+        val predicates = if (source != null) query.getPredicates() else nullptr
+        return TreeSitter.highlighterQuery(this.pointer, startRow, endRow, predicates, source, encoding)
+    }
+    
+    override fun close() {
+        TreeSitter.deleteHighlighter(this.pointer)
+    }
+}
+
@@ -16,6 +16,8 @@
 
 package io.github.module.treesitter
 
+import java.util.concurrent.ConcurrentHashMap
+
 sealed class TSLanguage(val pointer: Long = nullptr) {
     object Empty: TSLanguage(0L) // invalid language
     object Bash : TSLanguage(TreeSitter.getSupportLanguage(Bash::class.simpleName))
@@ -25,5 +27,65 @@ sealed class TSLanguage(val pointer: Long = nullptr) {
     object Kotlin : TSLanguage(TreeSitter.getSupportLanguage(Kotlin::class.simpleName))
     object Python : TSLanguage(TreeSitter.getSupportLanguage(Python::class.simpleName))
     object Rust : TSLanguage(TreeSitter.getSupportLanguage(Rust::class.simpleName))
+    // a language loaded at runtime, see TSLanguage.load
+    class Dynamic internal constructor(val name: String, pointer: Long) : TSLanguage(pointer)
+    
+    // the number of distinct node types
+    val symbolCount: Int
+        get() = TreeSitter.languageSymbolCount(checkedPointer())
+    
+    // the number of distinct field names
+    val fieldCount: Int
+        get() = TreeSitter.languageFieldCount(checkedPointer())
+    
+    // the ABI version of the language
+    val version: Int
+        get() = TreeSitter.languageVersion(checkedPointer())
+    
+    // the node type names indexed by the symbol id, exported once per language
+    val symbolNames: Array<String>
+        get() = symbolTables.getOrPut(checkedPointer()) {
+            TreeSitter.languageSymbolNames(pointer).map { it.intern() }.toTypedArray()
+        }
+    
+    // the field names indexed by the field id, the field ids start at 1
+    val fieldNames: Array<String?>
+        get() = fieldTables.getOrPut(checkedPointer()) {
+            TreeSitter.languageFieldNames(pointer).map { it?.intern() }.toTypedArray()
+        }
+    
+    fun symbolName(symbol: Int) = symbolNames[symbol]
+    
+    fun fieldName(fieldId: Int) = fieldNames[fieldId]
+    
+    // returns 0 if the language has no such node type
+    fun symbolForName(name: String, isNamed: Boolean = true): Int {
+        return TreeSitter.languageSymbolForName(checkedPointer(), name, isNamed)
+    }
+    
+    // returns 0 if the language has no such field
+    fun fieldIdForName(name: String): Int {
+        return TreeSitter.languageFieldIdForName(checkedPointer(), name)
+    }
+    
+    // the pointer is 0 if the grammar is not built into the library
+    private fun checkedPointer(): Long {
+        check(pointer != nullptr) { "the language ${this::class.simpleName} is not available" }
+        return pointer
+    }
+    
+    companion object {
+        // the name tables of each language pointer
+        private val symbolTables = ConcurrentHashMap<Long, Array<String>>()
+        private val fieldTables = ConcurrentHashMap<Long, Array<String?>>()
+        
+        // load tree_sitter_<name> from the library, libtree-sitter-<name>.so 
+        // by default, the loaded languages are cached natively. A language 
+        // version this tree-sitter can not parse is rejected as well
+        @Throws(UnsatisfiedLinkError::class)
+        fun load(name: String, pathname: String? = null): TSLanguage {
+            return Dynamic(name, TreeSitter.loadLanguage(pathname, name))
+        }
+    }
 }
 
@@ -16,58 +16,67 @@
 
 package io.github.module.treesitter
 
+// the fields mirror the native TSNode struct, a node crossing
+// JNI is a single object without any array
 data class TSNode(
-     @JvmField val context: IntArray?,
+     @JvmField val context0: Int,
+     @JvmField val context1: Int,
+     @JvmField val context2: Int,
+     @JvmField val context3: Int,
      @JvmField val id: Long,
      @JvmField val tree: Long
 ) {
     
     val startByte: Int
-        get() = TreeSitter.nodeStartByte(this)
+        get() = TreeSitter.nodeStartByte(context0, context1, context2, context3, id, tree)
         
     val endByte: Int
-        get() = TreeSitter.nodeEndByte(this)
+        get() = TreeSitter.nodeEndByte(context0, context1, context2, context3, id, tree)
     
     val startPoint: TSPoint
-        get() = TreeSitter.nodeStartPoint(this)
+        get() = TreeSitter.nodeStartPoint(context0, context1, context2, context3, id, tree)
         
     val endPoint: TSPoint
-        get() = TreeSitter.nodeEndPoint(this)
+        get() = TreeSitter.nodeEndPoint(context0, context1, context2, context3, id, tree)
         
     val type: String
-        get() = TreeSitter.nodeType(this)
+        get() = TreeSitter.nodeType(context0, context1, context2, context3, id, tree)
     
     val symbol: Int
-        get() = TreeSitter.nodeSymbol(this)
+        get() = TreeSitter.nodeSymbol(context0, context1, context2, context3, id, tree)
         
-    fun isNamed() = TreeSitter.nodeIsNamed(this)
+    fun isNamed() = TreeSitter.nodeIsNamed(context0, context1, context2, context3, id, tree)
         
-    fun isNull() = TreeSitter.nodeIsNull(this)
+    fun isNull() = TreeSitter.nodeIsNull(context0, context1, context2, context3, id, tree)
     
-    fun hasError() = TreeSitter.nodeHasError(this)
+    fun hasError() = TreeSitter.nodeHasError(context0, context1, context2, context3, id, tree)
     
     fun getChildCount(): Int {
-        return TreeSitter.nodeChildCount(this)
+        return TreeSitter.nodeChildCount(context0, context1, context2, context3, id, tree)
     }
     
     fun getNamedChildCount(): Int {
-        return TreeSitter.nodeNamedChildCount(this)
+        return TreeSitter.nodeNamedChildCount(context0, context1, context2, context3, id, tree)
     }
     
     fun getPrevSibling(): TSNode {
-        return TreeSitter.nodePrevSibling(this)
+        return TreeSitter.nodePrevSibling(context0, context1, context2, context3, id, tree)
     }
     
     fun getNextSibling(): TSNode {
-        return TreeSitter.nodeNextSibling(this)
+        return TreeSitter.nodeNextSibling(context0, context1, context2, context3, id, tree)
     }
     
     fun getPrevNamedSibling(): TSNode {
-        return TreeSitter.nodePrevNamedSibling(this)
+        return TreeSitter.nodePrevNamedSibling(context0, context1, context2, context3, id, tree)
     }
     
     fun getNextNamedSibling(): TSNode {
-        return TreeSitter.nodeNextNamedSibling(this)
+        return TreeSitter.nodeNextNamedSibling(context0, context1, context2, context3, id, tree)
+    }
+    
+    fun getParent(): TSNode {
+        return TreeSitter.nodeParent(context0, context1, context2, context3, id, tree)
     }
     
     fun walk(): TSTreeCursor {
@@ -77,15 +86,20 @@ data class TSNode(
     }
 
     fun childAt(index: Int): TSNode {
-        return TreeSitter.nodeChildAt(this, index)
+        return TreeSitter.nodeChildAt(context0, context1, context2, context3, id, tree, index)
     }
     
     fun namedChildAt(index: Int): TSNode {
-        return TreeSitter.nodeNamedChildAt(this, index)
+        return TreeSitter.nodeNamedChildAt(context0, context1, context2, context3, id, tree, index)
+    }
+    
+    // see TSLanguage.fieldIdForName
+    fun childByFieldId(fieldId: Int): TSNode {
+        return TreeSitter.nodeChildByFieldId(context0, context1, context2, context3, id, tree, fieldId)
     }
     
     fun childByFieldName(name: String): TSNode {
-        return TreeSitter.nodeChildByFieldName(this, name, name.length)
+        return TreeSitter.nodeChildByFieldName(context0, context1, context2, context3, id, tree, name, name.length)
     }
     
     override operator fun equals(other: Any?): Boolean = when {
@@ -95,7 +109,7 @@ data class TSNode(
     }
     
     override fun toString(): String {
-        return TreeSitter.nodeString(this)
+        return TreeSitter.nodeString(context0, context1, context2, context3, id, tree)
     }
 }
 
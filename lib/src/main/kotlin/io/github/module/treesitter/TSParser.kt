@@ -17,33 +17,78 @@
 package io.github.module.treesitter
 
 import java.io.Closeable
+import java.io.IOException
+import java.nio.ByteBuffer
 
-import kotlin.text.Charsets
 
-class TSParser : Pointer(), Closeable {
+// see treesitter parser parse function, one reader per parse call
+internal class TSInputReader(private val callback: (Int, TSPoint) -> ByteArray) {
+    // this method call by JNI
+    fun read(byteIndex: Int, row: Int, column: Int): ByteArray {
+        return callback(byteIndex, TSPoint(row, column))
+    }
+}
+
+// see treesitter parser parse function, the buffer is owned by native
+// and only valid during the read call
+internal class TSBufferReader(private val callback: (Int, ByteBuffer) -> Int) {
+    // this method call by JNI
+    fun read(byteIndex: Int, buffer: ByteBuffer): Int {
+        buffer.clear()
+        return callback(byteIndex, buffer)
+    }
+}
+
+// see treesitter parser logger, owned by the native parser
+internal class TSLogger(private val callback: (TSLogType, String) -> Unit) {
+    // this method call by JNI
+    fun log(type: TSLogType, message: String) {
+        return callback(type, message)
+    }
+}
+
+// the result of one file of TSParser.parseFiles, the time is in nanoseconds,
+// the tree is null and the error is the errno if the file cannot be parsed
+data class TSParseResult(
+    val pathname: String,
+    val tree: TSTree?,
+    val time: Long,
+    val error: Int
+)
+
+data class TSReparseResult(
+    val tree: TSTree,
+    val changedRanges: IntArray
+)
+
+class TSParser internal constructor(
+    pointer: Long, 
+    // the pool owning the parser, null for a standalone parser
+    private var pool: TSParserPool? = null
+) : Pointer(pointer), Closeable {
     
-    internal companion object {
-        // callbacks
-        private lateinit var function1: (Int, TSPoint) -> ByteArray
-        private lateinit var function2: (TSLogType, String) -> Unit
-        
-        // see treesitter parser parse function
-        // this method call by JNI
-        @JvmStatic
-        fun read(byteIndex: Int, point: TSPoint): ByteArray {
-            return function1(byteIndex, point)
-        }
-        
-        // this method call by JNI
-        @JvmStatic
-        fun logger(type: TSLogType, message: String) {
-            return function2(type, message)
+    // init native TSParser pointer
+    constructor() : this(TreeSitter.newParser())
+    
+    // the arena owning the parser and its trees, see TSArena.newParser
+    internal var arena: Long = nullptr
+    
+    // the new tree is owned by the arena of the parser
+    private fun newTree(tree: Long, source: Long = nullptr): TSTree {
+        return TSTree().also { 
+            it.pointer = tree
+            it.source = source
+            if (tree != nullptr) it.arena = arena
         }
     }
     
-    init {
-        // init native TSParser pointer
-        this.pointer = TreeSitter.newParser()
+    // the new tree shares the nodes of the old tree, 
+    // so both must belong to the same arena
+    private fun oldPointer(oldTree: TSTree?): Long {
+        require(oldTree == null || oldTree.arena == nullptr || oldTree.arena == arena) { 
+            "the old tree belongs to another arena" 
+        }
+        return oldTree?.pointer ?: nullptr
     }
     
     fun setLanguage(language: TSLanguage) {
@@ -62,10 +107,28 @@ class TSParser : Pointer(), Closeable {
         return TreeSitter.getParserTimeout(this.pointer)
     }
     
-    fun setLogger(callback: (TSLogType, String) -> Unit) {
-        // set callback
-        TSParser.function2 = callback
-        TreeSitter.setParserLogger(this.pointer)
+    fun setLogger(callback: ((TSLogType, String) -> Unit)?) {
+        TreeSitter.setParserLogger(this.pointer, callback?.let { TSLogger(it) })
+    }
+    
+    // the ranges are 6 ints each: startByte, endByte, startRow, startColumn, 
+    // endRow, endColumn, ordered and not overlapping, an empty array 
+    // includes the whole document
+    fun setIncludedRanges(ranges: IntArray): Boolean {
+        return TreeSitter.setParserIncludedRanges(this.pointer, ranges)
+    }
+    
+    fun setIncludedRanges(ranges: Array<TSRange>): Boolean {
+        val packed = IntArray(ranges.size * 6)
+        ranges.forEachIndexed { i, it ->
+            packed[i * 6] = it.startByte
+            packed[i * 6 + 1] = it.endByte
+            packed[i * 6 + 2] = it.startPoint.row
+            packed[i * 6 + 3] = it.startPoint.column
+            packed[i * 6 + 4] = it.endPoint.row
+            packed[i * 6 + 5] = it.endPoint.column
+        }
+        return TreeSitter.setParserIncludedRanges(this.pointer, packed)
     }
     
     fun cancel(flag: Boolean) {
@@ -76,29 +139,86 @@ class TSParser : Pointer(), Closeable {
         return TreeSitter.getParserCancellationFlag(this.pointer)
     }
     
-    // parse string
+    // parse string, an incremental parse returns a new tree 
+    // and the old tree stays valid until it is closed
     fun parse(
         text: String, 
         oldTree: TSTree? = null,
-        encoding: TSInputEncoding = TSInputEncoding.UTF16
+        encoding: TSInputEncoding = TSInputEncoding.UTF16,
+        // the tree keeps the source, see TSTree.text
+        retainSource: Boolean = false
     ): TSTree {
-        // specify the encoding of bytes
-        val bytes = when(encoding) {
-            TSInputEncoding.UTF8 -> text.toByteArray()
-            else -> text.toByteArray(Charsets.UTF_16LE)
+        val old = oldPointer(oldTree)
+        val source = if (retainSource) LongArray(1) else null
+        // the utf-16 characters of the string are read natively without any transcoding
+        val tree = when(encoding) {
+            TSInputEncoding.UTF8 -> TreeSitter.parseString(
+                this.pointer, old, text.toByteArray(), encoding, source
+            )
+            else -> TreeSitter.parseChars(this.pointer, old, text, source)
         }
     
-        return when(oldTree) {
-            null -> {
-                TSTree().also{
-                    it.pointer = TreeSitter.parseString(this.pointer, nullptr, bytes, encoding)
-                }
-            }
+        return newTree(tree, source?.get(0) ?: nullptr)
+    }
+    
+    // parse the remaining bytes of the buffer, a direct buffer is 
+    // handed to native without copy, a heap buffer is pinned
+    fun parse(
+        buffer: ByteBuffer,
+        oldTree: TSTree? = null,
+        encoding: TSInputEncoding = TSInputEncoding.UTF8
+    ): TSTree {
+        val old = oldPointer(oldTree)
+        val tree = when {
+            buffer.isDirect -> TreeSitter.parseDirectBuffer(
+                this.pointer, old, buffer, buffer.position(), buffer.remaining(), encoding
+            )
+            buffer.hasArray() -> TreeSitter.parseBytes(
+                this.pointer, old, buffer.array(), 
+                buffer.arrayOffset() + buffer.position(), buffer.remaining(), encoding
+            )
             else -> {
-                oldTree.pointer = TreeSitter.parseString(this.pointer, oldTree.pointer, bytes, encoding)
-                oldTree
+                // read-only heap buffer, the backing array is not accessible
+                val bytes = ByteArray(buffer.remaining())
+                buffer.duplicate().get(bytes)
+                TreeSitter.parseBytes(this.pointer, old, bytes, 0, bytes.size, encoding)
             }
         }
+        
+        return newTree(tree)
+    }
+    
+    // apply the edits to a copy of the tree and parse the edited source in one call, 
+    // every edit is 9 ints: startByte, oldEndByte, newEndByte, startRow, 
+    // startColumn, oldEndRow, oldEndColumn, newEndRow, newEndColumn.
+    // The old tree is left untouched, the changed ranges are 6 ints each: 
+    // startByte, endByte, startRow, startColumn, endRow, endColumn
+    fun reparse(
+        tree: TSTree,
+        edits: IntArray,
+        source: ByteArray,
+        encoding: TSInputEncoding = TSInputEncoding.UTF8
+    ): TSReparseResult? {
+        // the new tree and the handle of its source
+        val result = LongArray(2)
+        val ranges = TreeSitter.reparse(
+            this.pointer, oldPointer(tree), edits, source, encoding, result, tree.hasSource()
+        )
+        if (result[0] == nullptr) return null
+        return TSReparseResult(newTree(result[0], result[1]), ranges)
+    }
+    
+    // parse file, the text is read from the page cache without a java copy
+    @Throws(IOException::class)
+    fun parseFile(
+        pathname: String,
+        encoding: TSInputEncoding = TSInputEncoding.UTF8,
+        // the tree keeps the file mapped, see TSTree.text
+        retainSource: Boolean = false
+    ): TSTree {
+        val source = if (retainSource) LongArray(1) else null
+        val tree = TreeSitter.parseFile(this.pointer, pathname, encoding, source)
+        return newTree(tree, source?.get(0) ?: nullptr)
     }
     
     // parser parse
@@ -107,19 +227,20 @@ class TSParser : Pointer(), Closeable {
         oldTree: TSTree? = null,
         encoding: TSInputEncoding = TSInputEncoding.UTF16
     ): TSTree {
-        // set callback
-        TSParser.function1 = callback
-        return when(oldTree) {
-            null -> {
-                TSTree().also {
-                    it.pointer = TreeSitter.parserParse(this.pointer, nullptr, encoding)
-                }
-            }
-            else -> {
-                oldTree.pointer = TreeSitter.parserParse(this.pointer, oldTree.pointer, encoding)
-                oldTree
-            }
-        }
+        val reader = TSInputReader(callback)
+        return newTree(TreeSitter.parserParse(this.pointer, oldPointer(oldTree), reader, encoding))
+    }
+    
+    // parser parse, the callback writes the text starting at byteIndex into 
+    // the reusable native buffer and returns the number of bytes written, 
+    // returns 0 at the end of the text, the buffer must not be kept
+    fun parseBuffered(
+        callback: (byteIndex: Int, buffer: ByteBuffer) -> Int, 
+        oldTree: TSTree? = null,
+        encoding: TSInputEncoding = TSInputEncoding.UTF16
+    ): TSTree {
+        val reader = TSBufferReader(callback)
+        return newTree(TreeSitter.parserParseBuffer(this.pointer, oldPointer(oldTree), reader, encoding))
     }
     
     fun reset() {
@@ -130,8 +251,38 @@ class TSParser : Pointer(), Closeable {
         TreeSitter.parserDotGraphs(this.pointer, pathname)
     }
     
+    companion object {
+        // parse the files on native threads, each thread owns a parser
+        // and reads the files with mmap, throws IllegalArgumentException 
+        // if the language version is incompatible
+        fun parseFiles(
+            pathnames: List<String>,
+            language: TSLanguage,
+            threads: Int = Runtime.getRuntime().availableProcessors(),
+            encoding: TSInputEncoding = TSInputEncoding.UTF8
+        ): List<TSParseResult> {
+            require(threads > 0) { "the thread count must be positive" }
+            val timings = LongArray(pathnames.size)
+            val errors = IntArray(pathnames.size)
+            val trees = TreeSitter.parseFiles(
+                pathnames.toTypedArray(), language.pointer, threads, encoding, timings, errors
+            )
+            return pathnames.mapIndexed { i, pathname ->
+                val tree = if (trees[i] != nullptr) TSTree().also { it.pointer = trees[i] } else null
+                TSParseResult(pathname, tree, timings[i], errors[i])
+            }
+        }
+    }
+    
+    // a pooled parser goes back to its pool instead of being deleted
     override fun close() {
-        TreeSitter.deleteParser(this.pointer)
+        val owner = pool
+        if (owner != null) {
+            pool = null
+            owner.release(this)
+        } else {
+            TreeSitter.deleteParser(this.pointer)
+        }
     }
 }
 
@@ -0,0 +1,62 @@
+/*
+ * Copyright © 2023 Github Lzhiyong
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.module.treesitter
+
+import java.io.Closeable
+
+data class TSParserPoolStats(
+    val idle: Long,
+    val active: Long,
+    val created: Long,
+    val reused: Long
+)
+
+// keeps warmed parsers of each language, a released parser keeps its 
+// internal allocations and is reset before the next acquire, 
+// the pool can be shared by any number of threads
+class TSParserPool(capacity: Int = 4) : Pointer(), Closeable {
+    
+    init {
+        // init native parser pool pointer
+        this.pointer = TreeSitter.newParserPool(capacity)
+    }
+    
+    val stats: TSParserPoolStats
+        get() = TreeSitter.parserPoolStats(this.pointer).let {
+            TSParserPoolStats(it[0], it[1], it[2], it[3])
+        }
+    
+    // the parser returns to the pool when it is closed, throws 
+    // IllegalArgumentException if the language version is incompatible
+    fun acquire(language: TSLanguage): TSParser {
+        return TSParser(TreeSitter.parserPoolAcquire(this.pointer, language.pointer), this)
+    }
+    
+    internal fun release(parser: TSParser) {
+        TreeSitter.parserPoolRelease(this.pointer, parser.pointer)
+        parser.pointer = nullptr
+    }
+    
+    inline fun <R> use(language: TSLanguage, block: (TSParser) -> R): R {
+        return acquire(language).use(block)
+    }
+    
+    // the acquired parsers must be released before
+    override fun close() {
+        TreeSitter.deleteParserPool(this.pointer)
+    }
+}
@@ -21,14 +21,27 @@ import java.io.Closeable
 class TSQuery(
     language: TSLanguage, 
     expression: String,
-    onError: ((offset: Int, type: TSQueryError) -> Unit)? = null
+    onError: ((offset: Int, type: TSQueryError) -> Unit)? = null,
+    // share the compiled query with every query of the same language and 
+    // expression, the shared query is compiled once per process
+    val shared: Boolean = false
 ) : Pointer(), Closeable {
     
     init {
         // init native TSQuery pointer
-        this.pointer = TreeSitter.newQuery(language.pointer, expression, onError)
+        this.pointer = when(shared) {
+            true -> TreeSitter.newSharedQuery(language.pointer, expression, onError)
+            else -> TreeSitter.newQuery(language.pointer, expression, onError)
+        }
     }
     
+    // the natively compiled text predicates, created on the first use, 
+    // the query may be used by several threads at once. The predicates of 
+    // a shared query are compiled once per process as well, an invalid 
+    // #match? regex throws IllegalArgumentException on the first use
+    @Volatile
+    private var predicates: Long = nullptr
+    
     val patternCount: Int
         get() = TreeSitter.queryPatternCount(this.pointer)
     
@@ -63,16 +76,66 @@ class TSQuery(
         return TreeSitter.queryStringValueForId(this.pointer, id)
     }
     
+    // a shared query can not be changed, the other users would see it
     fun disableCapture(name: String?, id: Int) {
+        check(!shared) { "can not disable a capture of a shared query" }
         TreeSitter.queryDisableCapture(this.pointer, name, id)
     }
     
     fun disablePattern(id: Int) {
+        check(!shared) { "can not disable a pattern of a shared query" }
         TreeSitter.queryDisablePattern(this.pointer, id)
     }
     
+    // run the query over the whole tree on native threads, each thread takes
+    // disjoint top-level byte ranges, the captures are merged in document order.
+    // The match ids are only unique within a range. The predicates are checked 
+    // if a source is given
+    fun queryParallel(
+        tree: TSTree,
+        threads: Int = Runtime.getRuntime().availableProcessors(),
+        source: ByteArray? = null,
+        encoding: TSInputEncoding = TSInputEncoding.UTF8
+    ): TSQueryCaptures {
+        require(threads > 0) { "the thread count must be positive" }
+        val predicates = if (source != null) getPredicates() else nullptr
+        return TreeSitter.queryParallel(tree.pointer, this.pointer, threads, predicates, source, encoding)
+    }
+    
+    internal fun getPredicates(): Long {
+        val compiled = predicates
+        if (compiled != nullptr) return compiled
+        return synchronized(this) {
+            if (predicates == nullptr) {
+                predicates = when(shared) {
+                    true -> TreeSitter.sharedQueryPredicates(this.pointer)
+                    else -> TreeSitter.newQueryPredicates(this.pointer)
+                }
+            }
+            predicates
+        }
+    }
+    
     override fun close() {
-        TreeSitter.deleteQuery(this.pointer)
+        synchronized(this) {
+            // the predicates of a shared query are deleted with the cached query
+            if (predicates != nullptr && !shared) {
+                TreeSitter.deleteQueryPredicates(predicates)
+            }
+            predicates = nullptr
+        }
+        when(shared) {
+            true -> TreeSitter.releaseSharedQuery(this.pointer)
+            else -> TreeSitter.deleteQuery(this.pointer)
+        }
+    }
+    
+    companion object {
+        // delete the shared queries that are no longer used, 
+        // returns the number of deleted queries
+        fun trimCache(): Int {
+            return TreeSitter.trimQueryCache()
+        }
     }
 }
 
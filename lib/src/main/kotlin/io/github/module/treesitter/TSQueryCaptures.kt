@@ -0,0 +1,44 @@
+/*
+ * Copyright © 2023 Github Lzhiyong
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.module.treesitter
+
+// the captures of a query cursor packed into primitive columns,
+// the column k of the capture i is stored at columns[k * count + i]
+class TSQueryCaptures(val count: Int, val columns: IntArray, val ids: LongArray) {
+    
+    // the index of the capture name in the query
+    fun captureIndex(index: Int) = columns[index]
+    
+    fun patternIndex(index: Int) = columns[count + index]
+    
+    fun matchId(index: Int) = columns[2 * count + index]
+    
+    fun startByte(index: Int) = columns[3 * count + index]
+    
+    fun endByte(index: Int) = columns[4 * count + index]
+    
+    fun startPoint(index: Int) = TSPoint(columns[5 * count + index], columns[6 * count + index])
+    
+    fun endPoint(index: Int) = TSPoint(columns[7 * count + index], columns[8 * count + index])
+    
+    // the id of the captured node, same as TSNode.id
+    fun nodeId(index: Int) = ids[index]
+    
+    companion object {
+        const val COLUMN_COUNT = 9
+    }
+}
@@ -25,9 +25,13 @@ class TSQueryCursor : Pointer(), Closeable {
         this.pointer = TreeSitter.newQueryCursor()
     }
     
+    // the query of the last exec
+    private var query: TSQuery? = null
+    
     fun didExceedMatchLimit() = TreeSitter.queryCursorDidExceedMatchLimit(this.pointer)
     
     fun exec(query: TSQuery, node: TSNode) {
+        this.query = query
         TreeSitter.queryCursorExec(this.pointer, query.pointer, node)
     }
     
@@ -54,10 +58,41 @@ class TSQueryCursor : Pointer(), Closeable {
         return TreeSitter.queryCusorNextMatch(this.pointer)
     }
     
+    // the next match satisfying the #eq?, #match? and #any-of? predicates,
+    // the node text is read from the source that the tree was parsed from.
+    // The #match? regexes are ECMAScript regexes matched against the first 
+    // 1024 bytes of the text, an invalid regex throws IllegalArgumentException
+    fun nextMatch(source: ByteArray, encoding: TSInputEncoding = TSInputEncoding.UTF8): TSQueryMatch? {
+        val query = checkNotNull(query) { "the cursor has not been executed" }
+        return TreeSitter.queryCursorNextFilteredMatch(this.pointer, query.getPredicates(), source, encoding)
+    }
+    
     fun nextCapture(): TSCapture? {
         return TreeSitter.queryCusorNextCapture(this.pointer)
     }
     
+    // drain all of the remaining captures with a single native call
+    fun collectCaptures(): TSQueryCaptures {
+        return TreeSitter.queryCursorCollectCaptures(this.pointer)
+    }
+    
+    // same as collectCaptures, but the matches failing the predicates are dropped
+    fun collectCaptures(source: ByteArray, encoding: TSInputEncoding = TSInputEncoding.UTF8): TSQueryCaptures {
+        val query = checkNotNull(query) { "the cursor has not been executed" }
+        return TreeSitter.queryCursorCollectFilteredCaptures(this.pointer, query.getPredicates(), source, encoding)
+    }
+    
+    // the merged ranges of the nodes captured by the capture index, in the format
+    // of TSParser.setIncludedRanges, the predicates are checked if a source is given
+    fun captureRanges(
+        captureIndex: Int, 
+        source: ByteArray? = null, 
+        encoding: TSInputEncoding = TSInputEncoding.UTF8
+    ): IntArray {
+        val predicates = if (source != null) query?.getPredicates() ?: nullptr else nullptr
+        return TreeSitter.queryCursorCaptureRanges(this.pointer, captureIndex, predicates, source, encoding)
+    }
+    
     fun removeMatch(id: Int) {
         TreeSitter.queryCursorRemoveMatch(this.pointer, id)
     }
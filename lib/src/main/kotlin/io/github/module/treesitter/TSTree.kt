@@ -17,9 +17,31 @@
 package io.github.module.treesitter
 
 import java.io.Closeable
+import java.nio.BufferOverflowException
+import java.nio.ByteBuffer
 
 class TSTree : Pointer(), Closeable {
 
+    // the native handle of the retained source, owned by this tree
+    internal var source: Long = nullptr
+    
+    // the arena owning the nodes of this tree, see TSArena.newParser
+    internal var arena: Long = nullptr
+
+    // a snapshot sharing the nodes and the source of this tree, the snapshot has 
+    // its own lifetime and can be read on another thread while this tree is edited
+    fun copy(): TSTree {
+        return TSTree().also { 
+            it.pointer = TreeSitter.copyTree(this.pointer)
+            if (source != nullptr) it.source = TreeSitter.shareTreeSource(source)
+            // the snapshot shares the nodes allocated from the arena
+            if (arena != nullptr) {
+                TreeSitter.retainArena(arena)
+                it.arena = arena
+            }
+        }
+    }
+    
     val rootNode: TSNode
         get() = TreeSitter.getRootNode(this.pointer)
     
@@ -35,16 +57,101 @@ class TSTree : Pointer(), Closeable {
         return TreeSitter.getTreeChangedRanges(oldTree.pointer, this.pointer)
     }
     
+    // whether the tree was parsed with retainSource
+    fun hasSource(): Boolean {
+        return source != nullptr
+    }
+    
+    // the text of the node from the retained source, null if the 
+    // tree was parsed without retainSource
+    fun text(node: TSNode): String? {
+        require(node.tree == this.pointer) { "the node does not belong to the tree" }
+        return TreeSitter.nodeText(source, node.context0, node.context1, node.context2, node.context3, node.id, node.tree)
+    }
+    
+    // the text bytes of the node in the encoding of the source
+    fun textBytes(node: TSNode): ByteArray? {
+        require(node.tree == this.pointer) { "the node does not belong to the tree" }
+        return TreeSitter.nodeTextBytes(source, node.context0, node.context1, node.context2, node.context3, node.id, node.tree)
+    }
+    
+    // put the text bytes of the node into the buffer, returns the number of bytes or -1 
+    // if the tree retains no source, throws if the buffer has not enough space
+    fun textInto(node: TSNode, buffer: ByteBuffer): Int {
+        if (!buffer.isDirect) {
+            val bytes = textBytes(node) ?: return -1
+            buffer.put(bytes)
+            return bytes.size
+        }
+        
+        require(node.tree == this.pointer) { "the node does not belong to the tree" }
+        val length = TreeSitter.nodeTextInto(
+            source, node.context0, node.context1, node.context2, node.context3, node.id, node.tree, 
+            buffer, buffer.position(), buffer.remaining()
+        )
+        if (length > buffer.remaining()) throw BufferOverflowException()
+        if (length > 0) buffer.position(buffer.position() + length)
+        return length
+    }
+    
+    // the texts of all captures with a single native call
+    fun texts(captures: TSQueryCaptures): Array<String> {
+        val texts = TreeSitter.treeTexts(
+            source, captures.columns, 3 * captures.count, 4 * captures.count, captures.count
+        )
+        return checkNotNull(texts) { "the tree does not retain its source" }
+    }
+    
     fun getLanguage(): Long {
         return TreeSitter.getTreeLanguage(this.pointer)
     }
 
+    // the live native bytes freed by closing this tree, usable as the budget 
+    // of a tree cache. The nodes shared with a copy, or with the old or the new 
+    // tree of an incremental parse, are counted in neither tree until the other 
+    // one is closed. The tree is walked on each call, the nodes of an arena 
+    // are freed with the arena and not counted
+    fun getExclusiveBytes(): Long {
+        return TreeSitter.treeExclusiveBytes(this.pointer)
+    }
+    
+    fun getNodeCount(): Int {
+        return TreeSitter.treeNodeCount(this.pointer)
+    }
+    
+    // flatten the whole tree with a single native call
+    fun flatten(): TSFlatTree {
+        val data = TreeSitter.flattenTreeArray(this.pointer)
+        return TSFlatTree(data.size / TSFlatTree.COLUMN_COUNT, data)
+    }
+    
+    // returns the node count, or the negative node count 
+    // if the array is too small
+    fun flattenInto(array: IntArray): Int {
+        return TreeSitter.flattenTree(this.pointer, array)
+    }
+    
+    // the buffer must be direct, ints are written in the native byte order 
+    // starting at the position, the position is not changed
+    fun flattenInto(buffer: ByteBuffer): Int {
+        require(buffer.isDirect) { "the buffer must be a direct buffer" }
+        return TreeSitter.flattenTreeBuffer(this.pointer, buffer, buffer.position(), buffer.remaining())
+    }
+
     fun printGraph(pathname: String) {
         TreeSitter.treeDotGraph(this.pointer, pathname)
     }
     
     override fun close() {
+        if (source != nullptr) {
+            TreeSitter.deleteTreeSource(source)
+            source = nullptr
+        }
         TreeSitter.deleteTree(this.pointer)
+        if (arena != nullptr) {
+            TreeSitter.releaseArena(arena)
+            arena = nullptr
+        }
     }
 }
 
@@ -31,6 +31,11 @@ class TSTreeCursor : Pointer(), Closeable {
         return TreeSitter.cursorGotoParent(this.pointer)
     }
 
+    // 0 if the current node has no field
+    fun getCurrFieldId(): Int {
+        return TreeSitter.cursorCurrentFieldId(this.pointer)
+    }
+    
     fun getCurrFieldName(): String? {
         return TreeSitter.cursorCurrentFieldName(this.pointer)
     }
@@ -38,7 +43,33 @@ class TSTreeCursor : Pointer(), Closeable {
     fun getCurrNode(): TSNode {
         return TreeSitter.cursorCurrentNode(this.pointer)
     }
+    
+    // returns the index of the child, or -1 if there is no such child
+    fun gotoFirstChildForByte(byte: Int): Long {
+        return TreeSitter.cursorGotoFirstChildForByte(this.pointer, byte)
+    }
+    
+    fun gotoFirstChildForPoint(point: TSPoint): Long {
+        return TreeSitter.cursorGotoFirstChildForPoint(this.pointer, point.row, point.column)
+    }
+    
+    // move the cursor onto another node, reusing its memory
+    fun reset(node: TSNode) {
+        TreeSitter.resetTreeCursor(this.pointer, node)
+    }
+    
+    fun copy(): TSTreeCursor {
+        return TSTreeCursor().also {
+            it.pointer = TreeSitter.copyTreeCursor(this.pointer)
+        }
+    }
 
-    override fun close() = TreeSitter.deleteTreeCursor(this.pointer)
+    // the native cursor goes back to the cursor pool
+    override fun close() {
+        if (this.pointer != nullptr) {
+            TreeSitter.deleteTreeCursor(this.pointer)
+            this.pointer = nullptr
+        }
+    }
 }
 
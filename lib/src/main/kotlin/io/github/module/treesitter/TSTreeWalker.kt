@@ -0,0 +1,40 @@
+/*
+ * Copyright © 2023 Github Lzhiyong
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.module.treesitter
+
+// walks the subtree of the cursor's current node natively, many steps per call,
+// every visited node is written as 5 ints: depth, symbol, startByte, endByte, fieldId
+class TSTreeWalker(
+    private val cursor: TSTreeCursor,
+    private val postorder: Boolean = false,
+    private val namedOnly: Boolean = false,
+    // a negative depth walks the whole subtree
+    private val maxDepth: Int = -1
+) {
+    // the depth relative to the start node and the walk flags
+    private val state = IntArray(2)
+    
+    // fill the buffer, returns the number of nodes written, 0 once the walk is finished
+    fun next(buffer: IntArray): Int {
+        require(buffer.size >= TUPLE_SIZE) { "the buffer is smaller than one node" }
+        return TreeSitter.cursorWalk(cursor.pointer, buffer, state, postorder, namedOnly, maxDepth)
+    }
+    
+    companion object {
+        const val TUPLE_SIZE = 5
+    }
+}
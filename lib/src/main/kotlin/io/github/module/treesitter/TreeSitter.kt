@@ -17,6 +17,7 @@
 package io.github.module.treesitter
 
 import java.io.Closeable
+import java.nio.ByteBuffer
 
 import kotlin.text.Charsets
 
@@ -42,6 +43,23 @@ enum class TSQuantifier {
     ONE_OR_MORE
 }
 
+// how tree-sitter allocates outside of an arena, see TSArena
+enum class TSAllocatorMode {
+    DEFAULT, // malloc for each block
+    POOLED   // size classes recycled by each thread
+}
+
+// the kinds of the counted native memory, see TSAllocator.memoryStats,
+// a parse is counted as PARSER except the nodes of the new tree
+enum class TSMemoryKind {
+    OTHER,
+    PARSER,
+    TREE,
+    TREE_CURSOR,
+    QUERY,
+    QUERY_CURSOR
+}
+
 enum class TSQueryError {
   NONE,
   SYNTAX,
@@ -108,6 +126,8 @@ internal object TreeSitter {
     // ================= parser ==================
     // ts_parser_new
     external fun newParser(): Long
+    // ts_parser_new allocating from the arena
+    external fun newArenaParser(arena: Long): Long
     // ts_parser_delete
     external fun deleteParser(parser: Long)
     // ts_parser_reset
@@ -122,6 +142,35 @@ internal object TreeSitter {
         parser: Long, 
         oldTree: Long, 
         bytes: ByteArray, 
+        encoding: TSInputEncoding,
+        source: LongArray?
+    ): Long
+    
+    // ts_parser_parse_string_encoding, the string characters as UTF16
+    external fun parseChars(
+        parser: Long, 
+        oldTree: Long, 
+        text: String, 
+        source: LongArray?
+    ): Long
+    
+    // ts_parser_parse_string_encoding, direct ByteBuffer without copy
+    external fun parseDirectBuffer(
+        parser: Long, 
+        oldTree: Long, 
+        buffer: ByteBuffer, 
+        offset: Int, 
+        length: Int, 
+        encoding: TSInputEncoding
+    ): Long
+    
+    // ts_parser_parse_string_encoding, pinned ByteArray region
+    external fun parseBytes(
+        parser: Long, 
+        oldTree: Long, 
+        bytes: ByteArray, 
+        offset: Int, 
+        length: Int, 
         encoding: TSInputEncoding
     ): Long
     
@@ -129,13 +178,24 @@ internal object TreeSitter {
     external fun parserParse(
         parser: Long, 
         oldTree: Long, 
+        reader: TSInputReader,
+        encoding: TSInputEncoding
+    ): Long
+    
+    // ts_parser_parse, reads into a reusable native buffer
+    external fun parserParseBuffer(
+        parser: Long, 
+        oldTree: Long, 
+        reader: TSBufferReader,
         encoding: TSInputEncoding
     ): Long
     
+    // ts_parser_parse_string_encoding, the file is mapped by mmap
     external fun parseFile(
         parser: Long, 
         pathname: String, 
-        encoding: TSInputEncoding
+        encoding: TSInputEncoding,
+        source: LongArray?
     ): Long
    
     // ts_parser_set_timeout_micros
@@ -147,15 +207,52 @@ internal object TreeSitter {
     // ts_parser_cancellation_flag
     external fun getParserCancellationFlag(parser: Long): Boolean
     // ts_parser_set_logger
-    external fun setParserLogger(parser: Long)
+    external fun setParserLogger(parser: Long, logger: TSLogger?)
     // ts_parser_set_included_ranges
-    external fun setParserIncludedRanges(parser: Long, ranges: Array<IntArray>, length: Int)
+    external fun setParserIncludedRanges(parser: Long, ranges: IntArray): Boolean
     // ts_parser_print_dot_graphs
     external fun parserDotGraphs(parser: Long, file: String)
     
+    // ts_tree_edit, ts_parser_parse_string_encoding and ts_tree_get_changed_ranges
+    external fun reparse(
+        parser: Long,
+        oldTree: Long,
+        edits: IntArray,
+        source: ByteArray,
+        encoding: TSInputEncoding,
+        newTree: LongArray,
+        retainSource: Boolean
+    ): IntArray
+    
+    // ts_parser_parse_string_encoding on the worker threads
+    external fun parseFiles(
+        pathnames: Array<String>,
+        language: Long,
+        threads: Int,
+        encoding: TSInputEncoding,
+        timings: LongArray,
+        errors: IntArray
+    ): LongArray
+    
+    // ================= parser pool ==================
+    external fun newParserPool(capacity: Int): Long
+    external fun deleteParserPool(pool: Long)
+    // ts_parser_new or an idle parser
+    external fun parserPoolAcquire(pool: Long, language: Long): Long
+    // ts_parser_reset
+    external fun parserPoolRelease(pool: Long, parser: Long)
+    external fun parserPoolStats(pool: Long): LongArray
+    
     // ================= tree ==================
     // ts_tree_delete
     external fun deleteTree(tree: Long)
+    // a new handle sharing the retained source
+    external fun shareTreeSource(source: Long): Long
+    external fun deleteTreeSource(source: Long)
+    // the texts of the byte ranges of the retained source
+    external fun treeTexts(source: Long, columns: IntArray, startOffset: Int, endOffset: Int, count: Int): Array<String>?
+    // ts_tree_copy
+    external fun copyTree(tree: Long): Long
     // ts_tree_root_node
     external fun getRootNode(tree: Long): TSNode
     // ts_tree_language
@@ -168,46 +265,91 @@ internal object TreeSitter {
     external fun getTreeChangedRanges(oldTree: Long, newTree: Long): Array<TSRange>
     // ts_tree_print_dot_graph
     external fun treeDotGraph(tree: Long, file: String)
+    // ts_tree_cursor_goto_*, count the nodes
+    external fun treeNodeCount(tree: Long): Int
+    // ts_tree_cursor_goto_*, flatten into a new int array
+    external fun flattenTreeArray(tree: Long): IntArray
+    // ts_tree_cursor_goto_*, flatten into an int array
+    external fun flattenTree(tree: Long, array: IntArray): Int
+    // ts_tree_cursor_goto_*, flatten into a direct buffer from the position
+    external fun flattenTreeBuffer(tree: Long, buffer: ByteBuffer, position: Int, remaining: Int): Int
     
     // ================= node ==================
+    // the static functions take the TSNode fields as primitives,
+    // no object is marshaled on the call
     // ts_node_string
-    external fun nodeString(node: TSNode): String
+    @JvmStatic
+    external fun nodeString(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): String
     // ts_node_start_byte
-    external fun nodeStartByte(node: TSNode): Int
+    @JvmStatic
+    external fun nodeStartByte(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): Int
     // ts_node_end_byte
-    external fun nodeEndByte(node: TSNode): Int
+    @JvmStatic
+    external fun nodeEndByte(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): Int
+    // the node text of the retained source
+    @JvmStatic
+    external fun nodeText(source: Long, context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): String?
+    @JvmStatic
+    external fun nodeTextBytes(source: Long, context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): ByteArray?
+    @JvmStatic
+    external fun nodeTextInto(
+        source: Long, context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long,
+        buffer: ByteBuffer, offset: Int, capacity: Int
+    ): Int
     // ts_node_start_point
-    external fun nodeStartPoint(node: TSNode): TSPoint
+    @JvmStatic
+    external fun nodeStartPoint(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): TSPoint
     // ts_node_end_point
-    external fun nodeEndPoint(node: TSNode): TSPoint
+    @JvmStatic
+    external fun nodeEndPoint(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): TSPoint
     // ts_node_type
-    external fun nodeType(node: TSNode): String
+    @JvmStatic
+    external fun nodeType(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): String
     // ts_node_symbol
-    external fun nodeSymbol(node: TSNode): Int
+    @JvmStatic
+    external fun nodeSymbol(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): Int
     // ts_node_child_count
-    external fun nodeChildCount(node: TSNode): Int
+    @JvmStatic
+    external fun nodeChildCount(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): Int
     // ts_node_named_child_count
-    external fun nodeNamedChildCount(node: TSNode): Int
+    @JvmStatic
+    external fun nodeNamedChildCount(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): Int
     // ts_node_child
-    external fun nodeChildAt(node: TSNode, index: Int): TSNode
-     // ts_node_named_child
-    external fun nodeNamedChildAt(node: TSNode, index: Int): TSNode
+    @JvmStatic
+    external fun nodeChildAt(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long, index: Int): TSNode
+    // ts_node_named_child
+    @JvmStatic
+    external fun nodeNamedChildAt(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long, index: Int): TSNode
+    // ts_node_prev_sibling
+    @JvmStatic
+    external fun nodePrevSibling(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): TSNode
     // ts_node_next_sibling
-    external fun nodePrevSibling(node: TSNode): TSNode
-    // ts_node_next_sibling
-    external fun nodeNextSibling(node: TSNode): TSNode
-    // ts_node_next_named_sibling
-    external fun nodePrevNamedSibling(node: TSNode): TSNode
+    @JvmStatic
+    external fun nodeNextSibling(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): TSNode
+    // ts_node_prev_named_sibling
+    @JvmStatic
+    external fun nodePrevNamedSibling(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): TSNode
     // ts_node_next_named_sibling
-    external fun nodeNextNamedSibling(node: TSNode): TSNode
+    @JvmStatic
+    external fun nodeNextNamedSibling(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): TSNode
+    // ts_node_parent
+    @JvmStatic
+    external fun nodeParent(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): TSNode
     // ts_node_child_by_field_name
-    external fun nodeChildByFieldName(node: TSNode, name: String, length: Int): TSNode
+    @JvmStatic
+    external fun nodeChildByFieldName(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long, name: String, length: Int): TSNode
+    // ts_node_child_by_field_id
+    @JvmStatic
+    external fun nodeChildByFieldId(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long, fieldId: Int): TSNode
     // ts_node_is_named
-    external fun nodeIsNamed(node: TSNode): Boolean
+    @JvmStatic
+    external fun nodeIsNamed(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): Boolean
     // ts_node_is_null
-    external fun nodeIsNull(node: TSNode): Boolean
+    @JvmStatic
+    external fun nodeIsNull(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): Boolean
     // ts_node_has_error
-    external fun nodeHasError(node: TSNode): Boolean
+    @JvmStatic
+    external fun nodeHasError(context0: Int, context1: Int, context2: Int, context3: Int, id: Long, tree: Long): Boolean
     // ts_node_eq
     external fun nodeEquals(a: TSNode, b: TSNode): Boolean
     
@@ -224,6 +366,25 @@ internal object TreeSitter {
     external fun cursorGotoParent(cursor: Long): Boolean
     // ts_tree_cursor_current_field_name
     external fun cursorCurrentFieldName(cursor: Long): String?
+    // ts_tree_cursor_current_field_id
+    external fun cursorCurrentFieldId(cursor: Long): Int
+    // ts_tree_cursor_reset
+    external fun resetTreeCursor(cursor: Long, node: TSNode)
+    // ts_tree_cursor_copy
+    external fun copyTreeCursor(cursor: Long): Long
+    // ts_tree_cursor_goto_first_child_for_byte
+    external fun cursorGotoFirstChildForByte(cursor: Long, byte: Int): Long
+    // ts_tree_cursor_goto_first_child_for_point
+    external fun cursorGotoFirstChildForPoint(cursor: Long, row: Int, column: Int): Long
+    // ts_tree_cursor_goto_*, many steps per call
+    external fun cursorWalk(
+        cursor: Long, 
+        buffer: IntArray, 
+        state: IntArray, 
+        postorder: Boolean, 
+        namedOnly: Boolean, 
+        maxDepth: Int
+    ): Int
     // ts_tree_cursor_current_node
     external fun cursorCurrentNode(cursor: Long): TSNode
     
@@ -234,6 +395,14 @@ internal object TreeSitter {
         expression: String,
         onError: ((offset: Int, type: TSQueryError) -> Unit)?
     ): Long
+    // ts_query_new, compiled once per language and expression
+    external fun newSharedQuery(
+        language: Long, 
+        expression: String,
+        onError: ((offset: Int, type: TSQueryError) -> Unit)?
+    ): Long
+    external fun releaseSharedQuery(query: Long)
+    external fun trimQueryCache(): Int
     // ts_query_delete
     external fun deleteQuery(query: Long)
     // ts_query_pattern_count
@@ -285,9 +454,95 @@ internal object TreeSitter {
     external fun queryCursorRemoveMatch(cursor: Long, id: Int)
     // ts_query_cursor_next_capture
     external fun queryCusorNextCapture(cursor: Long): TSCapture?
+    // ts_query_cursor_next_capture, until there is no capture
+    external fun queryCursorCollectCaptures(cursor: Long): TSQueryCaptures
+    // ts_query_cursor_next_capture, the merged ranges of one capture
+    external fun queryCursorCaptureRanges(
+        cursor: Long, 
+        captureIndex: Int, 
+        predicates: Long, 
+        source: ByteArray?, 
+        encoding: TSInputEncoding
+    ): IntArray
+    // ts_query_cursor_set_byte_range on the worker threads
+    external fun queryParallel(
+        tree: Long, 
+        query: Long, 
+        threads: Int, 
+        predicates: Long, 
+        source: ByteArray?, 
+        encoding: TSInputEncoding
+    ): TSQueryCaptures
+    // ================= highlighter ==================
+    external fun newHighlighter(query: Long): Long
+    external fun deleteHighlighter(highlighter: Long)
+    // ts_tree_edit, moves the cached spans
+    external fun highlighterEdit(highlighter: Long, edits: IntArray)
+    // ts_tree_get_changed_ranges, invalidates the changed rows
+    external fun highlighterSetTree(highlighter: Long, tree: Long)
+    // ts_query_cursor_set_point_range, only the rows not cached
+    external fun highlighterQuery(
+        highlighter: Long, 
+        startRow: Int, 
+        endRow: Int, 
+        predicates: Long, 
+        source: ByteArray?, 
+        encoding: TSInputEncoding
+    ): IntArray
+    // the text predicates of all patterns
+    external fun newQueryPredicates(query: Long): Long
+    external fun deleteQueryPredicates(predicates: Long)
+    // the text predicates of a shared query, owned by the query cache
+    external fun sharedQueryPredicates(query: Long): Long
+    // ts_query_cursor_next_match, until the predicates are satisfied
+    external fun queryCursorNextFilteredMatch(
+        cursor: Long, 
+        predicates: Long, 
+        source: ByteArray, 
+        encoding: TSInputEncoding
+    ): TSQueryMatch?
+    // ts_query_cursor_next_capture, skip the matches failing the predicates
+    external fun queryCursorCollectFilteredCaptures(
+        cursor: Long, 
+        predicates: Long, 
+        source: ByteArray, 
+        encoding: TSInputEncoding
+    ): TSQueryCaptures
+    
+    // ================= allocator ==================
+    // ts_set_allocator
+    external fun setAllocatorMode(mode: TSAllocatorMode)
+    external fun getAllocatorMode(): Int
+    external fun beginArena(chunkSize: Int): Long
+    // false if the arena is not the innermost one or still owns objects
+    external fun endArena(arena: Long): Boolean
+    // the parsers and trees owned by the arena
+    external fun retainArena(arena: Long)
+    external fun releaseArena(arena: Long)
+    external fun arenaSize(arena: Long): Long
+    // the counters of each memory kind and the arena bytes
+    external fun memoryStats(): LongArray
+    // the live bytes freed when the tree is deleted
+    external fun treeExclusiveBytes(tree: Long): Long
     
     // ================= others ==================
     // languages
     external fun getSupportLanguage(name: String?): Long
+    // dlopen and dlsym
+    external fun loadLanguage(pathname: String?, name: String): Long
+    // ts_language_symbol_count
+    external fun languageSymbolCount(language: Long): Int
+    // ts_language_field_count
+    external fun languageFieldCount(language: Long): Int
+    // ts_language_version
+    external fun languageVersion(language: Long): Int
+    // ts_language_symbol_name
+    external fun languageSymbolNames(language: Long): Array<String>
+    // ts_language_field_name_for_id
+    external fun languageFieldNames(language: Long): Array<String?>
+    // ts_language_symbol_for_name
+    external fun languageSymbolForName(language: Long, name: String, isNamed: Boolean): Int
+    // ts_language_field_id_for_name
+    external fun languageFieldIdForName(language: Long, name: String): Int
 }
 
@@ -19,6 +19,7 @@ package io.github.module.treesitter
 import java.io.BufferedReader
 import java.io.File
 import java.nio.ByteBuffer
+import java.nio.ByteOrder
 
 import kotlin.text.Charsets
 import kotlin.system.*
@@ -165,6 +166,72 @@ class TreeSitterTest {
         parser.close()
     }
 
+    @Test fun parserParseConcurrent() {
+        val lines = listOf(
+            "#include <stdio.h>\n",
+            "\n",
+            "int main() {\n",
+            "\tprintf(\"tree-sitter\\n\");\n",
+            "\treturn 0;\n",
+            "}\n"
+        )
+        
+        val results = arrayOfNulls<String>(4)
+        val threads = List(results.size) { index ->
+            Thread {
+                val parser = TSParser()
+                parser.setLanguage(TSLanguage.C)
+                val tree = parser.parse(callback = { _, point ->
+                    if (point.row >= lines.size) {
+                        return@parse ByteArray(0)
+                    } else {
+                        return@parse lines[point.row].substring(point.column / 2).toByteArray(Charsets.UTF_16LE)
+                    }
+                })
+                results[index] = tree.rootNode.toString()
+                tree.close()
+                parser.close()
+            }
+        }
+        
+        threads.forEach(Thread::start)
+        threads.forEach(Thread::join)
+        
+        results.forEach { assertEquals(results[0], it) }
+    }
+    
+    @Test fun parseBuffered() {
+        val source = "#include <stdio.h>\n\nint main() {\n\tprintf(\"tree-sitter\\n\");\n\treturn 0;\n}\n"
+        val bytes = source.toByteArray(Charsets.UTF_16LE)
+        
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        
+        val tree = parser.parseBuffered(callback = { byteIndex, buffer ->
+            val count = minOf(bytes.size - byteIndex, buffer.remaining())
+            buffer.put(bytes, byteIndex, count)
+            count
+        })
+        val expected = parser.parse(source)
+        
+        assertEquals(expected.rootNode.toString(), tree.rootNode.toString())
+        
+        // the parser keeps its buffer, also across a logger change
+        parser.setLogger { _, _ -> }
+        parser.setLogger(null)
+        val again = parser.parseBuffered(callback = { byteIndex, buffer ->
+            val count = minOf(bytes.size - byteIndex, buffer.remaining())
+            buffer.put(bytes, byteIndex, count)
+            count
+        })
+        assertEquals(expected.rootNode.toString(), again.rootNode.toString())
+        
+        again.close()
+        expected.close()
+        tree.close()
+        parser.close()
+    }
+    
     @Test fun parseString() {
         var source = "#include <stdio.h>\n\nint main() {\n\tprintf(\"tree-sitter\\n\");\n\treturn 0;\n}\n"
        
@@ -192,6 +259,770 @@ class TreeSitterTest {
         parser.close()
     }
     
+    @Test fun parseBuffer() {
+        val source = "#include <stdio.h>\n\nint main() {\n\tprintf(\"tree-sitter\\n\");\n\treturn 0;\n}\n"
+        val bytes = source.toByteArray()
+        
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        
+        val direct = ByteBuffer.allocateDirect(bytes.size).put(bytes)
+        direct.flip()
+        val tree1 = parser.parse(direct)
+        val tree2 = parser.parse(ByteBuffer.wrap(bytes))
+        
+        assertEquals(tree1.rootNode.toString(), tree2.rootNode.toString())
+        assertEquals(bytes.size, tree1.rootNode.endByte)
+        
+        tree1.close()
+        tree2.close()
+        parser.close()
+    }
+    
+    @Test fun flattenTree() {
+        val source = "#include <stdio.h>\n\nint main() {\n\tprintf(\"tree-sitter\\n\");\n\treturn 0;\n}\n"
+        
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        val tree = parser.parse(source)
+        val root = tree.rootNode
+        
+        val flat = tree.flatten()
+        assertEquals(tree.getNodeCount(), flat.count)
+        assertEquals(root.symbol, flat.symbol(0))
+        assertEquals(-1, flat.parent(0))
+        assertEquals(root.endByte, flat.endByte(0))
+        for (i in 1 until flat.count) {
+            assertTrue(flat.parent(i) < i)
+            assertTrue(flat.startByte(i) >= flat.startByte(flat.parent(i)))
+        }
+        
+        assertEquals(-flat.count, tree.flattenInto(IntArray(1)))
+        
+        val buffer = ByteBuffer.allocateDirect(flat.data.size * 4).order(ByteOrder.nativeOrder())
+        assertEquals(flat.count, tree.flattenInto(buffer))
+        val ints = IntArray(flat.data.size)
+        buffer.asIntBuffer().get(ints)
+        assertTrue(ints.contentEquals(flat.data))
+        
+        // the ints are written from the position of the buffer
+        val offset = ByteBuffer.allocateDirect(flat.data.size * 4 + 8).order(ByteOrder.nativeOrder())
+        offset.position(8)
+        assertEquals(flat.count, tree.flattenInto(offset))
+        assertEquals(0, offset.getLong(0))
+        offset.asIntBuffer().get(ints)
+        assertTrue(ints.contentEquals(flat.data))
+        offset.position(12)
+        assertEquals(-flat.count, tree.flattenInto(offset))
+        
+        tree.close()
+        parser.close()
+    }
+    
+    @Test fun collectCaptures() {
+        val source = "#include <stdio.h>\n\nint main() {\n\tprintf(\"tree-sitter\\n\");\n\treturn 0;\n}\n"
+        val stream = {}.javaClass.getResource("/queries/c/highlights.scm")?.openStream()
+        val expression = stream?.bufferedReader()?.use(BufferedReader::readText) ?: ""
+        
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        val tree = parser.parse(source)
+        val query = TSQuery(TSLanguage.C, expression)
+        
+        val cursor = TSQueryCursor()
+        cursor.exec(query, tree.rootNode)
+        val expected = mutableListOf<TSCapture>()
+        var capture: TSCapture? = null
+        while ({capture = cursor.nextCapture(); capture}() != null) {
+            expected.add(capture!!)
+        }
+        
+        cursor.exec(query, tree.rootNode)
+        val captures = cursor.collectCaptures()
+        assertEquals(expected.size, captures.count)
+        expected.forEachIndexed { i, it ->
+            val node = it.match.captures[it.captureIndex].node
+            assertEquals(it.match.captures[it.captureIndex].index, captures.captureIndex(i))
+            assertEquals(it.match.patternIndex, captures.patternIndex(i))
+            assertEquals(node.startByte, captures.startByte(i))
+            assertEquals(node.endByte, captures.endByte(i))
+            assertEquals(node.id, captures.nodeId(i))
+        }
+        
+        cursor.close()
+        query.close()
+        tree.close()
+        parser.close()
+    }
+    
+    @Test fun queryPredicates() {
+        val source = "int main() {\n\tint a = 1;\n\tint FOO = 2;\n\treturn a;\n}\n"
+        val bytes = source.toByteArray()
+        val expression = """
+            ((identifier) @constant (#match? @constant "^[A-Z][A-Z_]*${'$'}"))
+            ((identifier) @name (#eq? @name "a"))
+            ((identifier) @keyword (#any-of? @keyword "main" "return"))
+            ((identifier) @other (#not-any-of? @other "a" "FOO" "main"))
+        """.trimIndent()
+        
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        val tree = parser.parse(source, encoding = TSInputEncoding.UTF8)
+        val query = TSQuery(TSLanguage.C, expression)
+        val cursor = TSQueryCursor()
+        
+        cursor.exec(query, tree.rootNode)
+        val texts = mutableListOf<String>()
+        var match: TSQueryMatch? = null
+        while ({match = cursor.nextMatch(bytes); match}() != null) {
+            val node = match!!.captures[0].node
+            texts.add(query.captureNameForId(match!!.captures[0].index) + ":" + 
+                source.substring(node.startByte, node.endByte))
+        }
+        assertEquals(listOf("constant:FOO", "keyword:main", "name:a", "name:a"), texts.sorted())
+        
+        cursor.exec(query, tree.rootNode)
+        val captures = cursor.collectCaptures(bytes)
+        assertEquals(texts.size, captures.count)
+        
+        // an invalid regex must not let every match pass
+        val invalid = TSQuery(TSLanguage.C, "((identifier) @name (#match? @name \"[a-\"))")
+        cursor.exec(invalid, tree.rootNode)
+        assertFailsWith<IllegalArgumentException> { cursor.collectCaptures(bytes) }
+        invalid.close()
+        
+        cursor.close()
+        query.close()
+        tree.close()
+        parser.close()
+    }
+    
+    @Test fun parserPool() {
+        val source = "int main() {\n\treturn 0;\n}\n"
+        val pool = TSParserPool(capacity = 2)
+        
+        val expected = pool.use(TSLanguage.C) { parser ->
+            parser.setTimeout(1000)
+            parser.parse(source).use { it.rootNode.toString() }
+        }
+        assertEquals(TSParserPoolStats(1, 0, 1, 0), pool.stats)
+        
+        pool.use(TSLanguage.C) { parser ->
+            assertEquals(0L, parser.getTimeout())
+            parser.parse(source).use { assertEquals(expected, it.rootNode.toString()) }
+        }
+        assertEquals(TSParserPoolStats(1, 0, 1, 1), pool.stats)
+        
+        val threads = List(4) {
+            Thread {
+                repeat(8) {
+                    pool.use(TSLanguage.C) { parser ->
+                        parser.parse(source).use { assertEquals(expected, it.rootNode.toString()) }
+                    }
+                }
+            }
+        }
+        threads.forEach { it.start() }
+        threads.forEach { it.join() }
+        
+        val stats = pool.stats
+        assertEquals(0L, stats.active)
+        assertTrue(stats.idle <= 2)
+        assertEquals(34L, stats.created + stats.reused)
+        
+        pool.close()
+    }
+    
+    @Test fun parseFiles() {
+        val pathname = {}.javaClass.getResource("/src/c/test.c")!!.path
+        val pathnames = List(16) { pathname } + "/not/exists/test.c"
+        
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        val expected = parser.parseFile(pathname)
+        
+        val results = TSParser.parseFiles(pathnames, TSLanguage.C, threads = 4)
+        assertEquals(pathnames.size, results.size)
+        results.dropLast(1).forEach {
+            assertEquals(0, it.error)
+            assertTrue(it.time > 0)
+            assertEquals(expected.rootNode.toString(), it.tree!!.rootNode.toString())
+            it.tree!!.close()
+        }
+        assertNull(results.last().tree)
+        assertNotEquals(0, results.last().error)
+        // a language no parser can use fails once instead of every file
+        assertFailsWith<IllegalArgumentException> { TSParser.parseFiles(pathnames, TSLanguage.Empty) }
+        
+        expected.close()
+        parser.close()
+    }
+    
+    @Test fun reparse() {
+        val source = "int main() {\n\treturn 0;\n}\n"
+        val edited = "int main() {\n\tint a = 1;\n\treturn a;\n}\n"
+        
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        val tree = parser.parse(source.toByteArray().let { ByteBuffer.wrap(it) })
+        
+        // insert "int a = 1;\n\t" at 14, then replace "0" with "a"
+        val edits = intArrayOf(
+            14, 14, 26, 1, 1, 1, 1, 2, 1,
+            33, 34, 34, 2, 8, 2, 9, 2, 9
+        )
+        val result = parser.reparse(tree, edits, edited.toByteArray())!!
+        val ranges = result.changedRanges
+        val expected = parser.parse(ByteBuffer.wrap(edited.toByteArray()))
+        
+        assertEquals(expected.rootNode.toString(), result.tree.rootNode.toString())
+        assertEquals(0, ranges.size % 6)
+        assertTrue(ranges.size > 0)
+        // the old tree is not modified
+        assertEquals(source.length, tree.rootNode.endByte)
+        
+        expected.close()
+        result.tree.close()
+        tree.close()
+        parser.close()
+    }
+    
+    @Test fun includedRanges() {
+        val source = "int a = 1;\nint main() {\n\treturn a;\n}\nint b = 2;\n"
+        val bytes = source.toByteArray()
+        
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        val tree = parser.parse(ByteBuffer.wrap(bytes))
+        val query = TSQuery(TSLanguage.C, "(function_definition) @function (declaration) @declaration")
+        
+        val cursor = TSQueryCursor()
+        cursor.exec(query, tree.rootNode)
+        // the two declarations, they do not overlap
+        val ranges = cursor.captureRanges(1, bytes)
+        assertEquals(12, ranges.size)
+        assertEquals(0, ranges[0])
+        assertEquals(source.indexOf("int b"), ranges[6])
+        
+        assertTrue(parser.setIncludedRanges(ranges))
+        val included = parser.parse(ByteBuffer.wrap(bytes))
+        assertEquals(0, included.rootNode.startByte)
+        assertEquals(source.length - 1, included.rootNode.endByte)
+        assertEquals(2, included.getIncluedRanges().size)
+        
+        // overlapping ranges are rejected
+        assertFalse(parser.setIncludedRanges(intArrayOf(0, 10, 0, 0, 0, 10, 5, 20, 0, 5, 1, 5)))
+        
+        included.close()
+        cursor.close()
+        query.close()
+        tree.close()
+        parser.close()
+    }
+    
+    @Test fun loadLanguage() {
+        val language = TSLanguage.C
+        assertTrue(language.symbolCount > 0)
+        assertTrue(language.fieldCount > 0)
+        assertTrue(language.version > 0)
+        
+        val pathname = "${System.getProperty("java.library.path")}/libtree-sitter-c.so"
+        val loaded = TSLanguage.load("c", pathname)
+        assertEquals(loaded.pointer, TSLanguage.load("c", pathname).pointer)
+        assertEquals(language.symbolCount, loaded.symbolCount)
+        
+        assertFailsWith<UnsatisfiedLinkError> { TSLanguage.load("unknown") }
+        
+        // a language without a grammar throws instead of crashing
+        assertFailsWith<IllegalStateException> { TSLanguage.Empty.symbolCount }
+        assertFailsWith<IllegalStateException> { TSLanguage.Empty.symbolNames }
+    }
+    
+    @Test fun symbolTables() {
+        val source = "int main() {\n\treturn 0;\n}\n"
+        val language = TSLanguage.C
+        val parser = TSParser()
+        parser.setLanguage(language)
+        val tree = parser.parse(source)
+        
+        val symbolNames = language.symbolNames
+        assertSame(symbolNames, language.symbolNames)
+        assertEquals(language.symbolCount, symbolNames.size)
+        assertEquals(language.fieldCount + 1, language.fieldNames.size)
+        
+        val function = tree.rootNode.namedChildAt(0)
+        assertEquals(function.type, language.symbolName(function.symbol))
+        assertEquals(function.symbol, language.symbolForName("function_definition"))
+        
+        val bodyId = language.fieldIdForName("body")
+        assertEquals("body", language.fieldName(bodyId))
+        assertEquals(function.childByFieldName("body"), function.childByFieldId(bodyId))
+        
+        val cursor = function.walk()
+        cursor.gotoFirstChild()
+        assertEquals(language.fieldIdForName("type"), cursor.getCurrFieldId())
+        assertEquals("type", cursor.getCurrFieldName())
+        
+        cursor.close()
+        tree.close()
+        parser.close()
+    }
+    
+    @Test fun treeWalker() {
+        val source = "#include <stdio.h>\n\nint main() {\n\tprintf(\"tree-sitter\\n\");\n\treturn 0;\n}\n"
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        val tree = parser.parse(source)
+        val flat = tree.flatten()
+        
+        // a small buffer so the walk is resumed several times
+        val buffer = IntArray(3 * TSTreeWalker.TUPLE_SIZE)
+        val symbols = mutableListOf<Int>()
+        var cursor = tree.rootNode.walk()
+        var walker = TSTreeWalker(cursor)
+        var count: Int
+        while (walker.next(buffer).also { count = it } > 0) {
+            for (i in 0 until count) symbols.add(buffer[i * TSTreeWalker.TUPLE_SIZE + 1])
+        }
+        assertEquals(List(flat.count) { flat.symbol(it) }, symbols)
+        cursor.close()
+        
+        // post-order ends with the root, named only and one level deep
+        cursor = tree.rootNode.walk()
+        walker = TSTreeWalker(cursor, postorder = true, namedOnly = true, maxDepth = 1)
+        val outline = IntArray(64 * TSTreeWalker.TUPLE_SIZE)
+        count = walker.next(outline)
+        assertEquals(tree.rootNode.getNamedChildCount() + 1, count)
+        assertEquals(tree.rootNode.symbol, outline[(count - 1) * TSTreeWalker.TUPLE_SIZE + 1])
+        assertEquals(0, walker.next(buffer))
+        cursor.close()
+        
+        tree.close()
+        parser.close()
+    }
+    
+    @Test fun treeCursor() {
+        val source = "int a = 1;\nint main() {\n\treturn a;\n}\n"
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        val tree = parser.parse(ByteBuffer.wrap(source.toByteArray()))
+        val root = tree.rootNode
+        
+        val cursor = root.walk()
+        assertEquals(1L, cursor.gotoFirstChildForByte(source.indexOf("main")))
+        assertEquals("function_definition", cursor.getCurrNode().type)
+        
+        val copy = cursor.copy()
+        cursor.reset(root)
+        assertEquals(root, cursor.getCurrNode())
+        assertEquals("function_definition", copy.getCurrNode().type)
+        
+        assertEquals(0L, cursor.gotoFirstChildForPoint(TSPoint(0, 4)))
+        assertEquals(-1L, copy.gotoFirstChildForByte(source.length))
+        
+        copy.close()
+        cursor.close()
+        // closing twice does not put the cursor back to the pool again
+        cursor.close()
+        
+        // the pooled cursors are reused
+        repeat(100) {
+            root.walk().use { assertEquals(root, it.getCurrNode()) }
+        }
+        
+        tree.close()
+        parser.close()
+    }
+    
+    @Test fun sharedQuery() {
+        val stream = {}.javaClass.getResource("/queries/c/highlights.scm")?.openStream()
+        val expression = stream?.bufferedReader()?.use(BufferedReader::readText) ?: ""
+        
+        val query1 = TSQuery(TSLanguage.C, expression, shared = true)
+        val query2 = TSQuery(TSLanguage.C, expression, shared = true)
+        val query3 = TSQuery(TSLanguage.C, expression)
+        assertEquals(query1.pointer, query2.pointer)
+        assertNotEquals(query1.pointer, query3.pointer)
+        assertFailsWith<IllegalStateException> { query1.disablePattern(0) }
+        
+        // the compiled predicates are shared with the query
+        assertNotEquals(nullptr, query1.getPredicates())
+        assertEquals(query1.getPredicates(), query2.getPredicates())
+        assertNotEquals(query1.getPredicates(), query3.getPredicates())
+        
+        query1.close()
+        // still referenced by query2
+        assertEquals(0, TSQuery.trimCache())
+        query2.close()
+        
+        // the released query is kept until the cache is trimmed
+        val query4 = TSQuery(TSLanguage.C, expression, shared = true)
+        assertEquals(query1.pointer, query4.pointer)
+        query4.close()
+        assertEquals(1, TSQuery.trimCache())
+        
+        query3.close()
+    }
+    
+    @Test fun queryParallel() {
+        val pathname = {}.javaClass.getResource("/src/c/test.c")!!.path
+        val stream = {}.javaClass.getResource("/queries/c/highlights.scm")?.openStream()
+        val expression = stream?.bufferedReader()?.use(BufferedReader::readText) ?: ""
+        
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        val tree = parser.parseFile(pathname)
+        val source = File(pathname).readBytes()
+        val query = TSQuery(TSLanguage.C, expression)
+        
+        val cursor = TSQueryCursor()
+        cursor.exec(query, tree.rootNode)
+        val expected = cursor.collectCaptures(source)
+        val captures = query.queryParallel(tree, threads = 4, source = source)
+        
+        assertEquals(expected.count, captures.count)
+        for (i in 0 until expected.count) {
+            assertEquals(expected.nodeId(i), captures.nodeId(i))
+            assertEquals(expected.captureIndex(i), captures.captureIndex(i))
+        }
+        assertFailsWith<IllegalArgumentException> { query.queryParallel(tree, threads = -1) }
+        
+        // the long comments put the range bounds on the functions, 
+        // the anchored matches cross the bounds
+        val documented = (0 until 64).joinToString("") { 
+            "// ${"documentation ".repeat(8)}$it\nint f$it() { return $it; }\n" 
+        }
+        val documentedTree = parser.parse(documented, encoding = TSInputEncoding.UTF8)
+        val anchored = TSQuery(TSLanguage.C, "((comment) @doc . (function_definition) @name)")
+        cursor.exec(anchored, documentedTree.rootNode)
+        val anchoredExpected = cursor.collectCaptures()
+        val anchoredCaptures = anchored.queryParallel(documentedTree, threads = 4)
+        
+        assertEquals(128, anchoredExpected.count)
+        assertEquals(anchoredExpected.count, anchoredCaptures.count)
+        for (i in 0 until anchoredExpected.count) {
+            assertEquals(anchoredExpected.nodeId(i), anchoredCaptures.nodeId(i))
+            assertEquals(anchoredExpected.captureIndex(i), anchoredCaptures.captureIndex(i))
+        }
+        
+        cursor.close()
+        anchored.close()
+        documentedTree.close()
+        query.close()
+        tree.close()
+        parser.close()
+    }
+    
+    @Test fun highlighter() {
+        val stream = {}.javaClass.getResource("/queries/c/highlights.scm")?.openStream()
+        val expression = stream?.bufferedReader()?.use(BufferedReader::readText) ?: ""
+        val source = "int a = 1;\nint b = 2;\nint c = 3;\n".toByteArray()
+        
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        val tree = parser.parse(ByteBuffer.wrap(source))
+        val query = TSQuery(TSLanguage.C, expression)
+        val highlighter = TSHighlighter(query)
+        highlighter.setTree(tree)
+        
+        val spans = highlighter.highlight(0, 3, source)
+        assertTrue(spans.size > 0 && spans.size % 3 == 0)
+        // the cached rows give the same spans
+        assertContentEquals(spans, highlighter.highlight(0, 3, source))
+        
+        // rename b to bb, only the second row is queried again
+        val newSource = "int a = 1;\nint bb = 2;\nint c = 3;\n".toByteArray()
+        val edits = intArrayOf(15, 16, 17, 1, 4, 1, 5, 1, 6)
+        highlighter.edit(edits)
+        val newTree = parser.reparse(tree, edits, newSource)!!.tree
+        highlighter.setTree(newTree)
+        
+        val fresh = TSHighlighter(query)
+        fresh.setTree(newTree)
+        assertContentEquals(fresh.highlight(0, 3, newSource), highlighter.highlight(0, 3, newSource))
+        
+        fresh.close()
+        highlighter.close()
+        query.close()
+        newTree.close()
+        tree.close()
+        parser.close()
+    }
+    
+    @Test fun highlighterMultiline() {
+        val stream = {}.javaClass.getResource("/queries/c/highlights.scm")?.openStream()
+        val expression = stream?.bufferedReader()?.use(BufferedReader::readText) ?: ""
+        val source = "/* one\n two\n three */\nint a = 1;\n".toByteArray()
+        
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        val tree = parser.parse(ByteBuffer.wrap(source))
+        val query = TSQuery(TSLanguage.C, expression)
+        val highlighter = TSHighlighter(query)
+        highlighter.setTree(tree)
+        highlighter.highlight(0, 4, source)
+        
+        // insert xx inside the comment, the comment span cached 
+        // by the first row ends 2 bytes later
+        val newSource = "/* one\n xxtwo\n three */\nint a = 1;\n".toByteArray()
+        val edits = intArrayOf(8, 8, 10, 1, 1, 1, 1, 1, 3)
+        highlighter.edit(edits)
+        val newTree = parser.reparse(tree, edits, newSource)!!.tree
+        highlighter.setTree(newTree)
+        
+        val fresh = TSHighlighter(query)
+        fresh.setTree(newTree)
+        val spans = highlighter.highlight(0, 4, newSource)
+        assertContentEquals(fresh.highlight(0, 4, newSource), spans)
+        assertEquals(0, spans[0])
+        assertEquals(23, spans[1])
+        
+        fresh.close()
+        highlighter.close()
+        query.close()
+        newTree.close()
+        tree.close()
+        parser.close()
+    }
+    
+    @Test fun nodeText() {
+        val source = "char *s = \"h\u00e9llo \ud83d\ude00\";\n"
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        
+        for (encoding in arrayOf(TSInputEncoding.UTF16, TSInputEncoding.UTF8)) {
+            val tree = parser.parse(source, encoding = encoding, retainSource = true)
+            assertTrue(tree.hasSource())
+            val value = tree.rootNode.namedChildAt(0)
+                .childByFieldName("declarator")
+                .childByFieldName("value")
+            assertEquals("\"h\u00e9llo \ud83d\ude00\"", tree.text(value))
+            
+            val buffer = ByteBuffer.allocateDirect(64)
+            val length = tree.textInto(value, buffer)
+            assertEquals(value.endByte - value.startByte, length)
+            assertEquals(length, buffer.position())
+            
+            // the copy shares the source and keeps it after the tree is closed
+            val copy = tree.copy()
+            tree.close()
+            assertEquals("\"h\u00e9llo \ud83d\ude00\"", copy.text(copy.rootNode.namedChildAt(0)
+                .childByFieldName("declarator")
+                .childByFieldName("value")))
+            assertFailsWith<IllegalArgumentException> { copy.text(value) }
+            copy.close()
+        }
+        
+        val tree = parser.parse(source)
+        assertFalse(tree.hasSource())
+        assertNull(tree.text(tree.rootNode))
+        tree.close()
+        
+        // the texts of all captures, read from the mapped file
+        val pathname = {}.javaClass.getResource("/src/c/test.c")!!.path
+        val stream = {}.javaClass.getResource("/queries/c/highlights.scm")?.openStream()
+        val expression = stream?.bufferedReader()?.use(BufferedReader::readText) ?: ""
+        val fileTree = parser.parseFile(pathname, retainSource = true)
+        val bytes = File(pathname).readBytes()
+        val query = TSQuery(TSLanguage.C, expression)
+        val cursor = TSQueryCursor()
+        cursor.exec(query, fileTree.rootNode)
+        val captures = cursor.collectCaptures()
+        val texts = fileTree.texts(captures)
+        for (i in 0 until captures.count) {
+            val expected = String(bytes, captures.startByte(i), captures.endByte(i) - captures.startByte(i))
+            assertEquals(expected, texts[i])
+        }
+        
+        cursor.close()
+        query.close()
+        fileTree.close()
+        parser.close()
+    }
+    
+    @Test fun parseChars() {
+        val source = "int main() {\n\tputs(\"h\u00e9llo \ud83d\ude00\");\n\treturn 0;\n}\n".repeat(100)
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        
+        val tree = parser.parse(source)
+        val bytes = source.toByteArray(Charsets.UTF_16LE)
+        val expected = parser.parse(ByteBuffer.wrap(bytes), encoding = TSInputEncoding.UTF16)
+        assertEquals(expected.rootNode.toString(), tree.rootNode.toString())
+        assertEquals(bytes.size, tree.rootNode.endByte)
+        
+        // the characters are copied when the logger calls back into java
+        parser.setLogger { _, _ -> }
+        val logged = parser.parse(source)
+        assertEquals(expected.rootNode.toString(), logged.rootNode.toString())
+        
+        logged.close()
+        expected.close()
+        tree.close()
+        parser.close()
+    }
+    
+    @Test fun treeSnapshot() {
+        val source = "int a = 1;\nint b = 2;\n"
+        val edited = "int a = 1;\nint bb = 2;\n"
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        val tree = parser.parse(source, encoding = TSInputEncoding.UTF8)
+        val expected = tree.rootNode.toString()
+        
+        // the snapshot is read on another thread while the tree is edited and reparsed
+        val snapshot = tree.copy()
+        var mismatches = 0
+        val reader = Thread {
+            repeat(100) { if (snapshot.rootNode.toString() != expected) mismatches++ }
+        }
+        reader.start()
+        tree.edit(TSInputEdit(15, 16, 17, TSPoint(1, 4), TSPoint(1, 5), TSPoint(1, 6)))
+        val newTree = parser.parse(edited, tree, TSInputEncoding.UTF8)
+        reader.join()
+        assertEquals(0, mismatches)
+        
+        assertNotSame(tree, newTree)
+        assertEquals(edited.length, newTree.rootNode.endByte)
+        assertEquals(source.length, snapshot.rootNode.endByte)
+        
+        // the snapshot outlives the tree it was copied from
+        tree.close()
+        assertEquals(expected, snapshot.rootNode.toString())
+        
+        snapshot.close()
+        newTree.close()
+        parser.close()
+    }
+    
+    @Test fun allocator() {
+        val source = "int main() {\n\treturn 0;\n}\n"
+        val expected = TSParser().use { parser ->
+            parser.setLanguage(TSLanguage.C)
+            parser.parse(source).use { it.rootNode.toString() }
+        }
+        
+        // the parser and its trees are allocated from the arena
+        val arena = TSArena()
+        val parser = arena.newParser()
+        parser.setLanguage(TSLanguage.C)
+        val tree = parser.parse(source)
+        val copy = tree.copy()
+        assertEquals(expected, tree.rootNode.toString())
+        assertTrue(arena.size > 0)
+        // the nodes are freed with the arena
+        assertEquals(0L, tree.getExclusiveBytes())
+        
+        // the arena can not end while it owns a parser or a tree
+        assertFailsWith<IllegalStateException> { arena.close() }
+        tree.close()
+        parser.close()
+        assertFailsWith<IllegalStateException> { arena.close() }
+        assertEquals(expected, copy.rootNode.toString())
+        copy.close()
+        arena.close()
+        
+        // a parser of an arena only parses in its arena
+        TSArena().use { outer ->
+            val outerParser = outer.newParser()
+            outerParser.setLanguage(TSLanguage.C)
+            TSArena().use { 
+                assertFailsWith<IllegalStateException> { outerParser.parse(source) }
+            }
+            outerParser.close()
+        }
+        
+        TSAllocator.mode = TSAllocatorMode.POOLED
+        try {
+            val parser = TSParser()
+            parser.setLanguage(TSLanguage.C)
+            repeat(10) {
+                parser.parse(source).use { assertEquals(expected, it.rootNode.toString()) }
+            }
+            parser.close()
+        } finally {
+            TSAllocator.mode = TSAllocatorMode.DEFAULT
+        }
+    }
+    
+    @Test fun memoryStats() {
+        val pathname = {}.javaClass.getResource("/src/c/test.c")!!.path
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        
+        val before = TSAllocator.memoryStats().usage(TSMemoryKind.TREE)
+        val tree = parser.parseFile(pathname)
+        val after = TSAllocator.memoryStats().usage(TSMemoryKind.TREE)
+        val bytes = tree.getExclusiveBytes()
+        assertTrue(bytes > 0)
+        assertTrue(bytes <= after.liveBytes - before.liveBytes)
+        assertTrue(after.totalCount > before.totalCount)
+        assertTrue(TSAllocator.memoryStats().usage(TSMemoryKind.PARSER).liveBytes > 0)
+        
+        // the nodes shared with the copy belong to the copy once the tree is closed
+        val copy = tree.copy()
+        val shared = tree.getExclusiveBytes()
+        assertTrue(shared < bytes)
+        tree.close()
+        assertTrue(copy.getExclusiveBytes() > shared)
+        copy.close()
+        
+        // the parse itself is counted as the parser
+        assertEquals(before.liveBytes, TSAllocator.memoryStats().usage(TSMemoryKind.TREE).liveBytes)
+        parser.close()
+        println(TSAllocator.memoryStats())
+    }
+    
+    @Test fun nodeNavigation() {
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        val tree = parser.parse("int a = 1; int b = 2;")
+        val root = tree.rootNode
+        
+        val first = root.namedChildAt(0)
+        val second = root.childAt(1)
+        assertEquals("declaration", first.type)
+        assertEquals(second, first.getNextSibling())
+        assertEquals(first, second.getPrevSibling())
+        assertEquals(second, first.getNextNamedSibling())
+        assertEquals(first, second.getPrevNamedSibling())
+        assertTrue(second.getNextSibling().isNull())
+        assertEquals(root, first.getParent())
+        assertTrue(root.getParent().isNull())
+        
+        val declarator = first.childByFieldName("declarator")
+        assertEquals("init_declarator", declarator.type)
+        assertEquals(first, declarator.getParent())
+        val fieldId = TSLanguage.C.fieldIdForName("declarator")
+        assertEquals(declarator, first.childByFieldId(fieldId))
+        
+        tree.close()
+        parser.close()
+    }
+    
+    @Test fun parseFile() {
+        val pathname = {}.javaClass.getResource("/src/c/test.c")!!.path
+        
+        val parser = TSParser()
+        parser.setLanguage(TSLanguage.C)
+        
+        var tree: TSTree
+        val time = measureTimeMillis {
+            tree = parser.parseFile(pathname)
+        }
+        
+        traverse(tree.rootNode)
+        assertEquals(File(pathname).length().toInt(), tree.rootNode.endByte)
+        println("parse file cost time:$time ms")
+        
+        assertFailsWith<java.io.IOException> {
+            parser.parseFile("$pathname.missing")
+        }
+        
+        tree.close()
+        parser.close()
+    }
+    
     @Test fun editTree() {
         
         var before = mutableListOf<String>(
@@ -249,6 +1080,7 @@ class TreeSitterTest {
         assertEquals(parser.isCancelled(), true)
         
         newTree.close()
+        oldTree.close()
         parser.close()
     }
 }